@@ -1,3 +1,7 @@
+/*
+ * This file has been altered to suit the needs of the Bootstrapped Freeze Interpreter.
+ */
+
 // SPDX-License-Identifier: Zlib
 /*
  * TINYEXPR - Tiny recursive descent parser and evaluation engine in C
@@ -35,6 +39,11 @@ For log = base 10 log do nothing
 For log = natural log uncomment the next line. */
 /* #define TE_NAT_LOG */
 
+/* Allocation of expressions
+Define TE_MALLOC(size) and TE_FREE(pointer) to use something other than
+malloc and free. By default, the expressions are counted by the memory
+statistics of the interpreter (see memstats.h). */
+
 #include "tinyexpr.h"
 #include <stdlib.h>
 #include <math.h>
@@ -51,6 +60,12 @@ For log = natural log uncomment the next line. */
 #define INFINITY (1.0/0.0)
 #endif
 
+#ifndef TE_MALLOC
+#include "../../include/memstats.h"
+#define TE_MALLOC(size) memstats_malloc((size), MEMSTATS_EXPRESSIONS)
+#define TE_FREE(pointer) memstats_free((pointer), MEMSTATS_EXPRESSIONS)
+#endif
+
 
 typedef double (*te_fun2)(double, double);
 
@@ -60,9 +75,6 @@ enum {
 };
 
 
-enum {TE_CONSTANT = 1};
-
-
 typedef struct state {
     const char *start;
     const char *next;
@@ -87,7 +99,7 @@ static te_expr *new_expr(const int type, const te_expr *parameters[]) {
     const int arity = ARITY(type);
     const int psize = sizeof(void*) * arity;
     const int size = (sizeof(te_expr) - sizeof(void*)) + psize + (IS_CLOSURE(type) ? sizeof(void*) : 0);
-    te_expr *ret = malloc(size);
+    te_expr *ret = TE_MALLOC(size);
     memset(ret, 0, size);
     if (arity && parameters) {
         memcpy(ret->parameters, parameters, psize);
@@ -115,7 +127,7 @@ void te_free_parameters(te_expr *n) {
 void te_free(te_expr *n) {
     if (!n) return;
     te_free_parameters(n);
-    free(n);
+    TE_FREE(n);
 }
 
 
@@ -226,9 +238,38 @@ static double mul(double a, double b) {return a * b;}
 static double divide(double a, double b) {return a / b;}
 static double negate(double a) {return -a;}
 static double comma(double a, double b) {(void)a; return b;}
+static double greater(double a, double b) {return a > b;}
+static double greater_eq(double a, double b) {return a >= b;}
+static double lower(double a, double b) {return a < b;}
+static double lower_eq(double a, double b) {return a <= b;}
+static double equal(double a, double b) {return a == b;}
+static double not_equal(double a, double b) {return a != b;}
+
+te_operator te_function_operator(const void *function) {
+    if (function == add) return TE_OPERATOR_ADD;
+    if (function == sub) return TE_OPERATOR_SUB;
+    if (function == mul) return TE_OPERATOR_MUL;
+    if (function == divide) return TE_OPERATOR_DIVIDE;
+    if (function == negate) return TE_OPERATOR_NEGATE;
+    if (function == comma) return TE_OPERATOR_COMMA;
+    if (function == greater) return TE_OPERATOR_GREATER;
+    if (function == greater_eq) return TE_OPERATOR_GREATER_EQ;
+    if (function == lower) return TE_OPERATOR_LOWER;
+    if (function == lower_eq) return TE_OPERATOR_LOWER_EQ;
+    if (function == equal) return TE_OPERATOR_EQUAL;
+    if (function == not_equal) return TE_OPERATOR_NOT_EQUAL;
+    return TE_OPERATOR_NONE;
+}
+
+const char *te_function_name(const void *function) {
+    const te_variable *builtin;
+    for (builtin = functions; builtin->name; builtin++)
+        if (builtin->address == function) return builtin->name;
+    return 0;
+}
 
 
-void next_token(state *s) {
+static void next_token(state *s) {
     s->type = TOK_NULL;
 
     do {
@@ -286,6 +327,24 @@ void next_token(state *s) {
                     case '(': s->type = TOK_OPEN; break;
                     case ')': s->type = TOK_CLOSE; break;
                     case ',': s->type = TOK_SEP; break;
+                    case '<':
+                        s->type = TOK_INFIX;
+                        if (s->next[0] == '=') {s->next++; s->function = lower_eq;}
+                        else s->function = lower;
+                        break;
+                    case '>':
+                        s->type = TOK_INFIX;
+                        if (s->next[0] == '=') {s->next++; s->function = greater_eq;}
+                        else s->function = greater;
+                        break;
+                    case '=':
+                        if (s->next[0] == '=') {s->next++; s->type = TOK_INFIX; s->function = equal;}
+                        else s->type = TOK_ERROR;
+                        break;
+                    case '!':
+                        if (s->next[0] == '=') {s->next++; s->type = TOK_INFIX; s->function = not_equal;}
+                        else s->type = TOK_ERROR;
+                        break;
                     case ' ': case '\t': case '\n': case '\r': break;
                     default: s->type = TOK_ERROR; break;
                 }
@@ -297,6 +356,7 @@ void next_token(state *s) {
 
 static te_expr *list(state *s);
 static te_expr *expr(state *s);
+static te_expr *test(state *s);
 static te_expr *power(state *s);
 
 static te_expr *base(state *s) {
@@ -359,7 +419,7 @@ static te_expr *base(state *s) {
                 int i;
                 for(i = 0; i < arity; i++) {
                     next_token(s);
-                    ret->parameters[i] = expr(s);
+                    ret->parameters[i] = test(s);
                     if(s->type != TOK_SEP) {
                         break;
                     }
@@ -423,7 +483,7 @@ static te_expr *factor(state *s) {
 
     if (ret->type == (TE_FUNCTION1 | TE_FLAG_PURE) && ret->function == negate) {
         te_expr *se = ret->parameters[0];
-        free(ret);
+        TE_FREE(ret);
         ret = se;
         neg = 1;
     }
@@ -502,13 +562,30 @@ static te_expr *expr(state *s) {
 }
 
 
-static te_expr *list(state *s) {
-    /* <list>      =    <expr> {"," <expr>} */
+static te_expr *test(state *s) {
+    /* <test>      =    <expr> {("<" | ">" | "<=" | ">=" | "==" | "!=") <expr>} */
     te_expr *ret = expr(s);
 
-    while (s->type == TOK_SEP) {
+    while (s->type == TOK_INFIX && (s->function == lower || s->function == lower_eq ||
+            s->function == greater || s->function == greater_eq ||
+            s->function == equal || s->function == not_equal)) {
+        te_fun2 t = s->function;
         next_token(s);
         ret = NEW_EXPR(TE_FUNCTION2 | TE_FLAG_PURE, ret, expr(s));
+        ret->function = t;
+    }
+
+    return ret;
+}
+
+
+static te_expr *list(state *s) {
+    /* <list>      =    <test> {"," <test>} */
+    te_expr *ret = test(s);
+
+    while (s->type == TOK_SEP) {
+        next_token(s);
+        ret = NEW_EXPR(TE_FUNCTION2 | TE_FLAG_PURE, ret, test(s));
         ret->function = comma;
     }
 
@@ -46,6 +46,7 @@ typedef struct te_expr {
 
 enum {
 	TE_VARIABLE = 0,
+	TE_CONSTANT = 1,
 
 	TE_FUNCTION0 = 8,
 	TE_FUNCTION1,
@@ -68,6 +69,27 @@ enum {
 	TE_FLAG_PURE = 32
 };
 
+// Bootstrapped Freeze Interpreter: which operator a function of a te_expr is (for code generators)
+typedef enum {
+	TE_OPERATOR_NONE = 0, // any other function, which can be called like a C function
+	TE_OPERATOR_ADD,
+	TE_OPERATOR_SUB,
+	TE_OPERATOR_MUL,
+	TE_OPERATOR_DIVIDE,
+	TE_OPERATOR_NEGATE,
+	TE_OPERATOR_COMMA,
+	TE_OPERATOR_GREATER,
+	TE_OPERATOR_GREATER_EQ,
+	TE_OPERATOR_LOWER,
+	TE_OPERATOR_LOWER_EQ,
+	TE_OPERATOR_EQUAL,
+	TE_OPERATOR_NOT_EQUAL
+} te_operator;
+
+te_operator te_function_operator(const void *function);
+/* Name of a builtin function (like "fac"), or NULL if it isn't one. */
+const char *te_function_name(const void *function);
+
 // Bootstrapped Freeze Interpreter Type Stuff
 enum Type {
 	DOUBLE_TYPE = 1, STRING_TYPE = 2, OBJECT_TYPE = 3
@@ -79,9 +101,6 @@ typedef struct te_variable {
 	const void *address;
 	int type;
 	void *context;
-
-	// Bootstrapped Freeze Interpreter Stuff
-	enum Type ty;
 } te_variable;
 
 /* Parses the input expression, evaluates it, and frees it. */
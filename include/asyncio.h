@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * asyncio.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef ASYNCIO_H_
+#define ASYNCIO_H_
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "../include/stringobj.h"
+#include "../include/listobj.h"
+#include "../include/threadpool.h"
+
+/*
+ * Asynchronous whole-file reads and writes for the read/write instructions.
+ * - requests are started right away and finish in the background
+ * - requests on the same path finish in the order they were made (a read after a write sees
+ * what was written)
+ * - io_uring is used when the kernel allows it, otherwise the requests are run on a thread pool
+ * (which also takes over if io_uring stops working)
+ */
+
+#define ASYNCIO_URING_ENTRIES 64
+#define ASYNCIO_THREADS 4
+#define ASYNCIO_READ_SIZE 65536
+
+typedef enum {
+	ASYNCIO_READ = 1, ASYNCIO_WRITE = 2
+} asyncio_kind;
+
+typedef struct asyncio_request {
+	asyncio_kind kind;
+	char *path;
+	string_t *data; // what is going to be written, or what has been read so far
+
+	// Belongs to whoever made the request (like the variable a read goes into)
+	void *context;
+	int line_num;
+
+	int error; // errno of the first thing that failed, 0 if everything went fine
+	bool done;
+	long long started; // a trace_now() time (only when the asyncio_t has a trace)
+
+	// Internal state
+	struct asyncio *io;
+	int fd;
+	long offset;
+	bool opened;
+	struct asyncio_request *next_same_path; // started once this one is done
+	struct asyncio_request *next_submit; // waiting for space in the io_uring
+} asyncio_request_t;
+
+typedef struct {
+	int fd;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	void *sqes, *cqes; // struct io_uring_sqe/io_uring_cqe arrays
+	void *sq_ring, *cq_ring;
+	size_t sq_ring_size, cq_ring_size, sqes_size;
+	unsigned in_flight;
+} asyncio_uring_t;
+
+typedef struct asyncio {
+	asyncio_uring_t *uring; // NULL when the thread pool is used instead
+	threadpool_t *pool; // NULL while io_uring is working
+
+	list_t *requests; // every unfinished request, in the order they were made
+	asyncio_request_t *submit_head, *submit_tail;
+
+	// Only used by the thread pool
+	pthread_mutex_t lock;
+
+	struct trace_t *trace; // every request is traced when it isn't NULL (see trace.h)
+} asyncio_t;
+
+asyncio_t* asyncio_init(bool allowUring);
+
+asyncio_request_t* asyncio_read(char *path, void *context, int line_num,
+		asyncio_t *io);
+/**
+ * Writes data (which now belongs to the request) to the file, replacing what was there.
+ */
+asyncio_request_t* asyncio_write(char *path, string_t *data, void *context,
+		int line_num, asyncio_t *io);
+
+/**
+ * Waits until every request has finished. Returns the requests in the order they were made
+ * (the caller frees them with asyncio_request_free()).
+ */
+list_t* asyncio_wait(asyncio_t *io);
+bool asyncio_pending(asyncio_t *io);
+
+void asyncio_request_free(void *request);
+/**
+ * Waits for everything that is still running, then frees the requests and the engine.
+ */
+void asyncio_free(asyncio_t *io);
+
+#endif /* ASYNCIO_H_ */
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * cache.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+#include "../include/interpreter.h"
+
+/*
+ * Program cache: the preprocessed functions of a script (with their resolved gotoline targets
+ * and tail calls)
+ * are saved next to it as "script.fzc", so the next run doesn't have to parse the script again.
+ *
+ * A cache file is only used if the size and modification time of the script, and the
+ * delimiters of the vm_t, are still the same as when it was saved.
+ */
+
+#define CACHE_EXTENSION "c" // appended to the script path
+#define CACHE_MAGIC "FZC"
+#define CACHE_VERSION 2
+
+/**
+ * Preprocesses the (already opened) script from its cache file if that is up to date, and
+ * otherwise parses the script and saves a new cache file for the next time.
+ */
+void cache_preprocess(FILE *stream, char *scriptPath, vm_t *vm);
+
+/**
+ * Replaces the functions of the vm_t with the ones in the cache file. Returns false (without
+ * changing anything) if the file is from a different version of the script or is damaged.
+ */
+bool cache_load(FILE *cache, struct stat *source, vm_t *vm);
+bool cache_save(FILE *cache, struct stat *source, vm_t *vm);
+
+#endif /* CACHE_H_ */
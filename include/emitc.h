@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * emitc.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef EMITC_H_
+#define EMITC_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "interpreter.h"
+
+/*
+ * Translates a preprocessed program into one standalone C file (freeze --emit-c out.c), so a
+ * finished script can be compiled ahead of time with cc -O2 out.c -lm -lpthread.
+ * - every function_t becomes a C function, with its arguments and locals as C variables
+ * - gotoline becomes a goto (through a switch when the line isn't a constant)
+ * - expressions are turned from their compiled te_expr back into C arithmetic, with the same
+ * exact int64 path as the interpreter for the ones made of integers (see intexpr.h)
+ * - tailfunc and calls in tail position become C calls right before a return, which the C
+ * compiler turns into jumps
+ *
+ * Variables keep their type at runtime (number or string), just like in the interpreter. A
+ * variable set by the top level code is global, anything else a function sets is local to it.
+ * A function may only set a global that the top level code sets before its first jump or
+ * call, since the interpreter makes it local when the function runs before the global exists.
+ * read, write and system finish right away, so wait has nothing left to do. spawn has no
+ * translation.
+ */
+
+/**
+ * Writes the C version of the program into the stream. Returns false (after saying why) if
+ * something in the program can't be translated.
+ */
+bool emitc_program(FILE *stream, char *scriptPath, vm_t *vm);
+
+#endif /* EMITC_H_ */
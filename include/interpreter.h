@@ -30,41 +30,162 @@
 #ifndef INTERPRETER_H_
 #define INTERPRETER_H_
 
+#include <stdio.h>
+#include <stdbool.h>
+
 #include "../include/stringobj.h"
 #include "../include/listobj.h"
+#include "../include/mapobj.h"
+#include "../include/asyncio.h"
+#include "../include/output.h"
+#include "../include/process.h"
+#include "../include/jit.h"
+#include "../include/profile.h"
+#include "../include/sampler.h"
+#include "../include/trace.h"
+#include "../include/value.h"
 #include "../deps/tinyexpr/tinyexpr.h"
 
+// The target of a gotoline is worked out when it runs (the line isn't a constant)
+#define PARSE_JUMP_UNRESOLVED -1
+
+// What an instruction does, worked out from its name when the program is loaded
+typedef enum {
+	OP_UNKNOWN = 0,
+	OP_SET,
+	OP_ADD,
+	OP_GOTOLINE,
+	OP_GOTOFUNC,
+	OP_TAILFUNC,
+	OP_PRINT,
+	OP_READ,
+	OP_WRITE,
+	OP_SYSTEM,
+	OP_SPAWN,
+	OP_WAIT,
+	OP_FUNCTIONEND,
+
+	// Superinstructions, for sequences that most loops are made of (see interpreter_optimize())
+	OP_SET_EXPRESSION, // set x, an expression that can't be a string
+	OP_ADD_GOTOLINE, // add i, 1 together with the gotoline right after it
+
+	// Variants for variables that are never strings (see preprocess_infertypes())
+	OP_SET_NUMBER,
+	OP_ADD_NUMBER,
+	OP_ADD_NUMBER_GOTOLINE
+} instruction_opcode;
+
 typedef struct {
 	string_t *name;
 	list_t *args;
+	instruction_opcode opcode;
+	int line_num; // line in the source file (starting from 1)
+	te_expr **compiled_args; // expression of every argument, compiled the first time it is used
+	jit_function *native_args; // machine code of the expressions, once the instruction is hot
+	int evaluation_count;
+	unsigned int integer_args; // bit i is set if argument i can be computed in integers (intexpr.h)
+	int jump_index; // where a gotoline with a constant line goes, or PARSE_JUMP_UNRESOLVED
+
+	// Call site cache of gotofunc, only valid while call_generation is the function_generation
+	struct function_t *call_target;
+	int call_generation;
+	bool tail_call; // nothing runs after the call returns, so it can replace the current call
+	te_variable *target_variable; // what set or add changes, found the first time it runs
+	long run_count; // how often it has run, if the vm_t counts instructions
+	long long profile_nanoseconds; // time spent running it, if the vm_t has a profile
 } parsed_instruction_t;
 
 // Everything is a function in my language :)
 
-typedef struct {
+typedef struct function_t {
+	string_t *name;
 	list_t *args;
 	list_t *parsed_instructions; // List of parsed_instruction_t
-	list_t *local_variables; // LOOK: hopefully this works because I was supposed to use te_variable array
+	list_t *local_variables; // list of te_variable structs, starting with the arguments
+	int active_count; // how many calls of the function are on the call stack
+	struct source_span_t *body; // where the rest of it is until it's first called (see source.h)
 } function_t;
 
+/*
+ * The call stack. Compiled expressions point to the local variables of a function, so the
+ * variables stay where they are: when a function that is already running is called again, the
+ * values of its locals are moved onto the slot stack and moved back when the call returns.
+ */
+
+#define CALL_STACK_INITIAL_FRAMES 64
+#define CALL_STACK_INITIAL_SLOTS 1024
+#define CALL_STACK_DEFAULT_DEPTH 100000
+#define CALL_RETURN_EXTERNAL -1 // the call came from outside of the script (interpreter_call)
+
+typedef struct {
+	function_t *funct, *caller;
+	int return_index; // the gotofunc in the caller, or CALL_RETURN_EXTERNAL
+	int slot_count; // locals saved on the slot stack (0 if the function wasn't running)
+	long long trace_started; // when tracing (a tail call keeps the time of the call it replaced)
+} call_frame_t;
+
+typedef struct {
+	value_t value;
+} call_slot_t;
+
 typedef struct {
 	// Core internal features of the interpreter
 	char set_delimiter;
 	char arg_delimiter;
+	char comment_delimiter; // lines starting with this are skipped
 
 	// Function identifiers
 	string_t *function_declare, *function_end;
 
 	string_t *var_declare, *var_add;
 	string_t *goto_line, *goto_function;
+	string_t *tail_function; // a gotofunc that returns from the current function afterwards
 
 	string_t *print_function, *read_function, *write_function, *system_function;
+	string_t *spawn_function; // like system, but doesn't wait for the command to finish
+	string_t *wait_function; // waits for the reads, writes and commands that are still running
 
 	// Lists
 	list_t *global_variables; // list of te_variable structs
 	list_t *function_list; // list of function_t structs
+	map_t *function_map; // the same functions by name (except for <main>)
+	int function_generation; // changes with the function map, so call site caches know they are old
+	map_t *string_names; // variables that can hold strings, NULL unless there are numeric opcodes
+	struct source_map_t *source; // where the functions are, if it was loaded by interpreter_reload()
 	int currentFunction;
 
+	// Number of threads for parsing big files (0 means one per processor)
+	int preprocess_threads;
+
+	// Execution state, so that every vm_t can run on its own thread
+	output_t *output; // where print writes to (stdout by default)
+	bool running;
+	int error_count;
+
+	// Call stack (grows by doubling, so calls only allocate until the deepest call so far)
+	call_frame_t *frames;
+	int frame_count, frames_allocated;
+	call_slot_t *slots;
+	int slot_count, slots_allocated;
+	int max_call_depth; // deeper calls stop the program with a StackOverflowException
+
+	bool count_instructions; // for finding new superinstructions (see tools/sequences.c)
+	profile_t *profile; // times every instruction and call when it isn't NULL (see profile.h)
+	sampler_t *sampler; // keeps the call stack for statistical profiling (see sampler.h)
+	trace_t *trace; // records phases, I/O, commands and slow calls when it isn't NULL
+
+	// Machine code for hot expressions (see jit.h)
+	jit_t *jit; // started by the first hot instruction
+	bool jit_enabled;
+
+	// File I/O (read and write don't block, see asyncio.h)
+	asyncio_t *io; // started by the first read or write
+	bool io_uring; // false to always use the thread pool instead
+
+	// Commands started by spawn (see process.h), collected in order by wait
+	list_t *children; // list of process_t structs
+	int max_children; // spawn waits for one to finish when this many are running
+
 } vm_t; // Short and simple name
 
 /**
@@ -76,19 +197,88 @@ vm_t* vm_init();
  * Frees whatever the interpreter has been storing in the vm_t structure.
  */
 void vm_free(vm_t *vm);
+/**
+ * Clears every variable (but keeps the program), so the same vm_t can run again like it has
+ * just been loaded.
+ */
+void vm_reset(vm_t *vm);
 
 /**
  * Starts the interpreter provided a file containing the interpreter code
  * Inspiration from the V8's ignition
+ *
+ * Everything the interpreter needs is inside the vm_t (there is no global state), so different
+ * vm_t's can be run on different threads at the same time.
  */
 void interpreter_ignition(FILE *stream, vm_t *virt);
+/**
+ * Runs the top level code of a program that has already been preprocessed.
+ */
+void interpreter_run(vm_t *vm);
+/**
+ * Calls a function by name from outside of a script (the name of the call is the name of the
+ * function). The arguments are evaluated as if the top level code had called gotofunc.
+ */
+void interpreter_call(parsed_instruction_t *call, vm_t *vm);
+/**
+ * Runs the stream while it is being read, for input that is too big (or too slow) to be read
+ * before it runs, like a pipe. Every line of top level code runs as soon as it has been read,
+ * and is freed once the output has been flushed, so the memory used doesn't grow with the
+ * input. Functions are kept, and can be called once their functionend has been read. A
+ * gotoline at the top level can only skip the lines that haven't been read yet.
+ */
+void interpreter_stream(FILE *stream, vm_t *vm);
+function_t* interpreter_findfunction(string_t *name, vm_t *vm);
+/**
+ * Builds the function map again from the function list (after the list has been replaced).
+ */
+void interpreter_indexfunctions(vm_t *vm);
+/**
+ * Loads the source (see source.h) into a vm_t that isn't running. Only the functions whose text
+ * changed since the source it was loaded from last time are parsed again, and the ones that
+ * didn't change are kept with their variables and compiled expressions. The new functions
+ * replace the old ones all at once, and only if the new source has no errors (otherwise false
+ * is returned, and the program stays the way it was). The vm_t keeps the source.
+ */
+bool interpreter_reload(struct source_map_t *source, vm_t *vm);
+/**
+ * Parses every function that hasn't been called yet, for whatever needs the whole program.
+ */
+void interpreter_loadall(vm_t *vm);
+/**
+ * Gives every instruction its opcode, and turns common sequences into superinstructions.
+ * Needs the jumps to be resolved already.
+ */
+void interpreter_optimize(vm_t *vm);
+/**
+ * Writes how often every instruction has run, one instruction per line in program order:
+ * function, line, count and instruction name, separated by tabs.
+ */
+void interpreter_writecounts(FILE *stream, vm_t *vm);
+/**
+ * Reads the whole stream and loads it with interpreter_reload(). Only the top level code is
+ * parsed right away, and functions are parsed the first time they are called. Big files with a
+ * lot of top level code (or with nested functions) are parsed in parallel chunks, functions
+ * and all. Afterwards, every gotoline to a constant line is resolved to an instruction index,
+ * and calls in tail position are marked.
+ */
 void interpreter_preprocessfile(FILE *stream, vm_t *vm);
+/**
+ * Runs the instructions of a function, starting from the instruction at index lineNum. Calls
+ * inside of the script are run by the same loop (see call_frame_t), so deep recursion doesn't
+ * use up the C stack.
+ */
+void interpreter_execute(int lineNum, function_t *funct, vm_t *vm);
+void interpreter_print(parsed_instruction_t *instr, function_t *funct, vm_t *vm);
 parsed_instruction_t* parse(char whitespace_delimiter, char arg_delimiter,
 		string_t *line);
 
-function_t* function_init(list_t *args);
+function_t* function_init(string_t *name, list_t *args);
 void function_free(void *funct);
 
 void parsed_instruction_free(void *instruction);
 
+te_variable* variable_init(char *name);
+void variable_free(void *var);
+
 #endif /* INTERPRETER_H_ */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * intexpr.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef INTEXPR_H_
+#define INTEXPR_H_
+
+#include <stdbool.h>
+
+#include "../deps/tinyexpr/tinyexpr.h"
+
+/*
+ * Exact 64-bit integer arithmetic for expressions that are made of integers.
+ *
+ * An expression qualifies if it only has integer constants, variables, + - * and negation,
+ * the comparisons and commas (so no division or functions). It is evaluated in int64 as long
+ * as every variable holds a whole number: then i * j - k is exact even when i * j is above
+ * 2^53, where doubles round. A variable that isn't a whole number (or a string) or a result
+ * that overflows int64 promotes the whole expression to doubles, as if there were no integer
+ * path. Only the result is turned into a double, since variables are stored as doubles, and
+ * being exact, it's never -0 (like 0 * -1 is in doubles).
+ *
+ * The JIT compiles the same rules into integer instructions (see jit.c), so an expression
+ * gives the same result before and after it gets hot.
+ */
+
+/**
+ * Returns true if the expression can be evaluated in integers, and that could give another
+ * result than doubles: an arithmetic result has to go into another operation, since a single
+ * operation on whole numbers (like i + 1 or i < n) rounds only once either way.
+ */
+bool intexpr_check(const te_expr *expr);
+/**
+ * Evaluates the expression in integers. Returns false if it has to be evaluated as doubles
+ * instead (with te_eval()).
+ */
+bool intexpr_eval(const te_expr *expr, double *result);
+/**
+ * Returns true if the double is an integer that int64 can hold, and puts it into integer.
+ * -0.0 isn't one, so that its sign survives.
+ */
+bool intexpr_integer(double number, long long *integer);
+
+#endif /* INTEXPR_H_ */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * jit.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef JIT_H_
+#define JIT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../deps/tinyexpr/tinyexpr.h"
+
+/*
+ * Compiles hot expressions into x86-64 machine code (SSE2 scalar doubles).
+ * - variables are loaded straight from the address they are bound to, so the code stays valid
+ * for as long as the compiled te_expr does
+ * - + - * / and the comparisons become single instructions, sqrt becomes sqrtsd, and every
+ * other function (sin, pow, ...) is called directly
+ * - expressions made of integers (see intexpr.h) are computed in 64-bit integer registers first,
+ * and jump to the double code if a variable isn't a whole number or something overflows
+ * - anything the JIT can't compile (like closures) returns NULL, and is left to te_eval()
+ *
+ * On other processors jit_init() always returns NULL, so everything is interpreted.
+ */
+
+#define JIT_BUFFER_SIZE (1024 * 1024) // code for all expressions of one vm_t
+#define JIT_HOT_THRESHOLD 1000 // evaluations of an instruction before it is compiled
+#define JIT_MAX_DEPTH 64 // deeper expressions are interpreted
+
+typedef double (*jit_function)(void);
+
+typedef struct {
+	unsigned char *buffer; // mapped executable, except while code is being written
+	size_t used;
+	bool full; // out of space (or the system doesn't allow executable memory)
+} jit_t;
+
+/**
+ * Returns NULL if there is no JIT for this processor or no executable memory.
+ */
+jit_t* jit_init();
+jit_function jit_compile(const te_expr *expr, jit_t *jit);
+void jit_free(jit_t *jit);
+
+#endif /* JIT_H_ */
@@ -31,6 +31,7 @@
 #define LISTOBJ_H_
 
 #include <stdio.h>
+#include <stdbool.h>
 
 #define LIST_MANAGER_ALLOC_SIZE 10
 
@@ -58,10 +59,10 @@ void list_clear(list_t *list);
  * Compares the data according to how the data must be compared with the equalsComparator function
  */
 bool list_equals(void *destComp, int index, bool (*equalsComparator) (void*, void*), list_t *list);
-bool list_contains(void *destComp, bool *(equalsComparator) (void *, void *), list_t *list);
+bool list_contains(void *destComp, bool (*equalsComparator) (void *, void *), list_t *list);
 
 void list_serialize(void (*indiv) (void *, FILE *), FILE *stream, list_t *list);
-list_t* list_deserialize(void* (*indivreverse) (FILE *));
+list_t* list_deserialize(void* (*indivreverse) (FILE *), FILE *stream);
 
 void list_free(list_t *list);
 /**
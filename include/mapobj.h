@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * mapobj.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef MAPOBJ_H_
+#define MAPOBJ_H_
+
+#include <stdbool.h>
+
+#include "../include/stringobj.h"
+
+#define MAP_MANAGER_ALLOC_SIZE 16 // has to be a power of two
+
+/*
+ * Hash map from string_t keys to anything, with open addressing.
+ * - keys aren't copied, so the owner of a key (like a function_t and its name) has to outlive
+ * its entry; the key stored in the map is the one shared (interned) name
+ * - the first value put under a key stays, like the first match of a linear search
+ */
+
+typedef struct {
+	string_t *key; // NULL if the entry is empty
+	unsigned int hash;
+	void *value;
+} map_entry_t;
+
+typedef struct {
+	map_entry_t *entries;
+
+	int data_length;
+	int data_allocated_length;
+} map_t;
+
+map_t* map_init();
+
+/**
+ * Returns false (and keeps the old value) if the key is already in the map.
+ */
+bool map_put(string_t *key, void *value, map_t *map);
+void* map_get(string_t *key, map_t *map);
+
+void map_clear(map_t *map);
+void map_free(map_t *map);
+
+/**
+ * FNV-1a hash of the bytes.
+ */
+unsigned int map_hash(char *text, int length);
+
+#endif /* MAPOBJ_H_ */
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * memstats.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef MEMSTATS_H_
+#define MEMSTATS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <malloc.h>
+
+/*
+ * Where the memory of the process goes (freeze --mem-stats script.fz).
+ *
+ * The allocations of strings, lists, instructions, expressions, variables and I/O buffers go
+ * through the functions in here, which count the live bytes, the peak and the number of
+ * allocations of every category. The sizes come from malloc_usable_size(), so nothing is added
+ * to the allocations, and a block that is freed with plain free() (or counted in the wrong
+ * category) only throws off the numbers.
+ *
+ * Strings and lists also keep track of how much of their capacity is used, so the report can
+ * show how much the growth of STRING_ALLOCATION_SIZE and LIST_MANAGER_ALLOC_SIZE wastes. Code
+ * that changes the length of a string_t or list_t by itself calls memstats_capacity() too.
+ *
+ * Counting is off until memstats_enable() is called, and then costs a few atomic adds per
+ * allocation. The counters belong to the whole process (every vm_t and thread).
+ */
+
+typedef enum {
+	MEMSTATS_STRINGS,
+	MEMSTATS_LISTS,
+	MEMSTATS_INSTRUCTIONS, // functions and parsed instructions
+	MEMSTATS_EXPRESSIONS, // compiled by tinyexpr (see TE_MALLOC in tinyexpr.c)
+	MEMSTATS_VARIABLES,
+	MEMSTATS_IO, // output buffers and file requests
+	MEMSTATS_CATEGORY_COUNT
+} memstats_category;
+
+extern bool memstats_enabled;
+
+void memstats_enable(void);
+/**
+ * Adds bytes (negative when they were freed) to the live bytes of a category, and counts
+ * allocations (or frees, when it is negative).
+ */
+void memstats_count(memstats_category category, long bytes, int allocations);
+void memstats_countcapacity(memstats_category category, long capacity,
+		long used);
+/**
+ * Writes the live bytes, peak bytes and allocation counts of every category, and how much of
+ * the capacity of strings and lists isn't used.
+ */
+void memstats_report(FILE *stream);
+
+/**
+ * Adds to the capacity of the strings or lists of a category, and to how much of it is used
+ * (in bytes, either can be negative).
+ */
+static inline void memstats_capacity(memstats_category category, long capacity,
+		long used) {
+	if (memstats_enabled)
+		memstats_countcapacity(category, capacity, used);
+}
+
+static inline void* memstats_malloc(size_t size, memstats_category category) {
+	void *pointer = malloc(size);
+	if (memstats_enabled && pointer != NULL)
+		memstats_count(category, malloc_usable_size(pointer), 1);
+	return pointer;
+}
+
+static inline void* memstats_calloc(size_t count, size_t size,
+		memstats_category category) {
+	void *pointer = calloc(count, size);
+	if (memstats_enabled && pointer != NULL)
+		memstats_count(category, malloc_usable_size(pointer), 1);
+	return pointer;
+}
+
+static inline void* memstats_realloc(void *pointer, size_t size,
+		memstats_category category) {
+	if (!memstats_enabled)
+		return realloc(pointer, size);
+	long before = pointer != NULL ? (long) malloc_usable_size(pointer) : 0;
+	void *resized = realloc(pointer, size);
+	if (resized != NULL) {
+		// A resize isn't a new allocation, unless there was nothing before
+		memstats_count(category, (long) malloc_usable_size(resized) - before,
+				pointer == NULL);
+	}
+	return resized;
+}
+
+static inline void memstats_free(void *pointer, memstats_category category) {
+	if (memstats_enabled && pointer != NULL)
+		memstats_count(category, -(long) malloc_usable_size(pointer), -1);
+	free(pointer);
+}
+
+#endif /* MEMSTATS_H_ */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * output.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <stdbool.h>
+#include <sys/uio.h>
+
+/*
+ * Buffered output for print (and anything else a script writes to its output).
+ * - small things are copied into one big buffer, and numbers are formatted straight into it
+ * - big things that don't change (like the strings inside of the instructions) aren't copied at
+ * all; they are written together with the buffer in one writev()
+ */
+
+#define OUTPUT_BUFFER_SIZE 65536
+// Anything at least this long is referenced instead of copied, if it allows that
+#define OUTPUT_DIRECT_SIZE 1024
+#define OUTPUT_MAX_PIECES 64
+
+typedef enum {
+	OUTPUT_FLUSH_NEWLINE = 1, // after every print that ends a line (like a terminal expects)
+	OUTPUT_FLUSH_SIZE = 2, // whenever the buffer is full
+	OUTPUT_FLUSH_EXIT = 3 // only when the program is done (the buffer grows instead)
+} output_flush_policy;
+
+typedef struct {
+	int fd;
+	output_flush_policy policy;
+
+	char *buffer; // allocated by the first write
+	int buffer_length, buffer_allocated_length;
+	int buffer_written; // how much of the buffer is already one of the pieces
+
+	// Everything that is waiting to be written, in order
+	struct iovec pieces[OUTPUT_MAX_PIECES];
+	int piece_count;
+
+	bool has_newline;
+	int error; // errno of the first write that failed (later output is dropped)
+} output_t;
+
+/**
+ * The file descriptor still belongs to the caller (output_free() doesn't close it).
+ */
+output_t* output_init(int fd, output_flush_policy policy);
+/**
+ * Newline for terminals, size for everything else.
+ */
+output_flush_policy output_defaultpolicy(int fd);
+
+void output_append(output_t *out, char *text, int length);
+/**
+ * Like output_append(), but the text is only referenced, so it has to stay the same until
+ * the next output_flush().
+ */
+void output_appendstatic(output_t *out, char *text, int length);
+void output_appendchar(output_t *out, char letter);
+void output_appenddouble(output_t *out, double number);
+
+/**
+ * Called at the end of every print, which is where the newline policy flushes.
+ */
+void output_endwrite(output_t *out);
+bool output_flush(output_t *out);
+
+void output_free(output_t *out);
+
+#endif /* OUTPUT_H_ */
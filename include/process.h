@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * process.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef PROCESS_H_
+#define PROCESS_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "../include/stringobj.h"
+#include "../include/listobj.h"
+
+/*
+ * Child processes for the system and spawn instructions.
+ * - commands are started with posix_spawn() (no fork, so the page tables of a big interpreter
+ * aren't copied), and without a shell unless the command needs one (pipes, quotes, $, etc.)
+ * or isn't a program (a shell builtin, or a command that doesn't exist)
+ * - any number of children can run at once, and their output is read while waiting for them
+ */
+
+#define PROCESS_SHELL "/bin/sh"
+// Anything with one of these characters is given to the shell instead of being split on spaces
+#define PROCESS_SHELL_CHARACTERS "|&;<>()$`\\\"'*?[]#~=%{}\n"
+
+typedef struct {
+	pid_t pid;
+	char *command;
+	int pidfd; // readable once the child has exited (-1 if the kernel doesn't have pidfds)
+	int output_fd; // read end of the pipe, -1 if the output isn't captured
+
+	string_t *output; // everything the child has written so far (NULL if not captured)
+	int status; // exit code, or 128 + the signal that stopped it
+	bool done;
+
+	// Belongs to whoever started the process (like the variables the results go into)
+	void *status_context, *output_context;
+	int line_num;
+	long long started, finished; // CLOCK_MONOTONIC nanoseconds, if the starter sets started
+} process_t;
+
+/**
+ * Starts the command. The output of the child is either captured, or goes straight to
+ * stdoutFd. Returns NULL (with errno set) if the command couldn't be started.
+ */
+process_t* process_spawn(char *command, bool capture, int stdoutFd);
+
+/**
+ * Blocks until at least one of the unfinished processes is done, reading the output of all of
+ * them while waiting. Does nothing if every process is already done.
+ */
+void process_waitany(list_t *processes);
+int process_runningcount(list_t *processes);
+
+/**
+ * Kills the process if it is still running.
+ */
+void process_free(void *process);
+
+#endif /* PROCESS_H_ */
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * profile.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "../include/listobj.h"
+
+/*
+ * Where the time of a script goes (freeze --profile report.txt script.fz).
+ * - every instruction counts how often it ran and how long it took (see parsed_instruction_t)
+ * - the calls are kept as a tree of call stacks, so every function knows its own time, the time
+ * of the calls it made, and how often it was called
+ * - the report lists the lines and the functions by time, and report.txt.folded has one line
+ * per call stack ("<main>;fib;fib 1234", in nanoseconds) for flame graph tools
+ *
+ * Only the loop for counting and timing (see interpreter_execute()) calls into here, so the
+ * normal loop doesn't get any slower.
+ */
+
+#define PROFILE_FOLDED_EXTENSION ".folded" // appended to the path of the report
+
+// One function on one call stack
+typedef struct profile_node_t {
+	struct profile_function_t *function;
+	struct profile_node_t *parent;
+	list_t *children; // list of profile_node_t structs
+	long calls;
+	long long nanoseconds; // spent in the instructions of the function itself
+	long long total_nanoseconds; // including the calls it made (worked out for the report)
+	int next_child; // for walking the tree without recursion
+} profile_node_t;
+
+// Every call stack of one function added together
+typedef struct profile_function_t {
+	struct function_t *funct; // NULL for the top level code
+	long calls;
+	long long nanoseconds, total_nanoseconds;
+	int open_count; // how often it is on the path to the node that is being walked
+} profile_function_t;
+
+typedef struct {
+	profile_node_t *root, *current;
+	list_t *nodes; // every profile_node_t, for freeing them
+	list_t *functions; // list of profile_function_t structs
+	long long started; // when the profile started
+} profile_t;
+
+profile_t* profile_init();
+// Nanoseconds of a monotonic clock
+long long profile_now();
+// A call of funct starts (replacing the current call if it is a tail call)
+void profile_enter(struct function_t *funct, bool tail, profile_t *profile);
+// The current call returns
+void profile_leave(profile_t *profile);
+
+/**
+ * Writes the lines and functions of the program (from the function list) sorted by time, and
+ * the folded call stacks into the other stream.
+ */
+void profile_report(FILE *report, FILE *folded, list_t *functions,
+		profile_t *profile);
+void profile_free(profile_t *profile);
+
+#endif /* PROFILE_H_ */
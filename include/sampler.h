@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * sampler.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef SAMPLER_H_
+#define SAMPLER_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "../include/listobj.h"
+
+/*
+ * A statistical profiler (freeze --sample report.txt script.fz) that is cheap enough to leave
+ * on. A timer on the CPU time of the interpreter thread sends it SIGPROF (1000 times a second
+ * by default), and the signal handler adds the call stack of the script at that moment to a
+ * fixed table. Nothing is allocated and no lock is taken inside of the handler.
+ *
+ * The call stack is kept by the loop that runs the instructions (see interpreter_execute()):
+ * every frame is a function and the index of its instruction that is running, which the loop
+ * updates with one atomic store per instruction. The report has the samples of every line and
+ * every function, and report.txt.folded has the sampled call stacks for flame graph tools,
+ * with the line of every frame ("<main>:20;fib:11;fib:17 42").
+ */
+
+// Samples per second of CPU time (the kernel can round this down to its timer tick)
+#define SAMPLER_DEFAULT_FREQUENCY 1000
+#define SAMPLER_MAX_DEPTH 64 // deeper calls only keep the innermost frame
+#define SAMPLER_TABLE_SIZE 4096 // different call stacks that can be told apart
+
+typedef struct {
+	struct function_t *funct;
+	atomic_int index; // of the instruction that is running in the function
+} sampler_frame_t;
+
+// A frame of a call stack that has been sampled
+typedef struct {
+	struct function_t *funct;
+	int index;
+} sampler_site_t;
+
+// The samples of one call stack
+typedef struct {
+	unsigned int hash;
+	int depth; // 0 if the entry is empty
+	bool truncated; // the stack was deeper, and the last site is the innermost frame
+	long count;
+	sampler_site_t sites[SAMPLER_MAX_DEPTH];
+} sampler_entry_t;
+
+typedef struct sampler_t {
+	// Written by the interpreter, read by the signal handler (which interrupts the same thread)
+	sampler_frame_t stack[SAMPLER_MAX_DEPTH];
+	sampler_frame_t overflow; // the innermost frame, when the calls go deeper than the stack
+	atomic_int depth; // can be more than SAMPLER_MAX_DEPTH
+
+	sampler_entry_t *table;
+	long sample_count, dropped_count; // dropped when the table is full
+	int frequency;
+	pid_t thread; // the thread that runs the script (others ignore the signal)
+	timer_t timer;
+	bool timer_created; // otherwise setitimer() is used
+	struct sigaction previous_action;
+} sampler_t;
+
+sampler_t* sampler_init(int frequency);
+/**
+ * Starts taking samples of the calling thread. Only one sampler can run at a time in a
+ * process (since signals go to the whole process). Returns false if the timer can't be started.
+ */
+bool sampler_start(sampler_t *sampler);
+void sampler_stop(sampler_t *sampler);
+
+/**
+ * The interpreter calls these when a call starts and when it returns (to the caller). Both
+ * return the frame that is now on the top, which is where the index of the running
+ * instruction goes.
+ */
+sampler_frame_t* sampler_enter(struct function_t *funct, bool tail,
+		sampler_t *sampler);
+sampler_frame_t* sampler_leave(struct function_t *caller, sampler_t *sampler);
+
+/**
+ * Writes the lines and functions of the program (from the function list) by samples, and the
+ * folded call stacks into the other stream.
+ */
+void sampler_report(FILE *report, FILE *folded, list_t *functions,
+		sampler_t *sampler);
+void sampler_free(sampler_t *sampler);
+
+#endif /* SAMPLER_H_ */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * server.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include "../include/interpreter.h"
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "../include/listobj.h"
+
+/*
+ * Protocol (one request per connection):
+ * - the client sends one line: the name of the script, a space, and then the function to run
+ * with its arguments, written just like a gotofunc ("math.fz area 2, 3")
+ * - the server streams back everything the function prints, followed by a '\0' byte, the
+ * number of errors as text ("0\n" means it went fine) and the exceptions the request threw (one
+ * line each), and closes the connection
+ *
+ * Exceptions are printed on the stderr of the server too. The ones about the request line
+ * itself (including the arguments of the call) have no line number.
+ *
+ * Prefork mode answers the same requests, but every request is run by its own child process.
+ * The children are forked ahead of time from a parent that has already loaded the scripts and
+ * run their top level code, so they start with the whole program (and its global variables)
+ * shared copy-on-write. A script that crashes or corrupts memory only takes its own child down.
+ *
+ * Scripts are reloaded when their file changes: the server looks before every request (prefork
+ * looks before forking a worker), and only the functions that changed are parsed again (see
+ * interpreter_reload()). The top level code of a reloaded script runs again, so its global
+ * variables are up to date. A script with errors keeps running the way it was until the file
+ * is changed again.
+ */
+
+#define SERVER_MAX_REQUEST_LENGTH 65536
+// Exit status of a prefork worker that couldn't accept, so the parent stops forking new ones
+#define SERVER_WORKER_FAILED 2
+
+typedef struct {
+	char *name; // what requests call the script by (the file name without the directory)
+	char *path;
+	struct timespec modified; // of the file when it was last loaded
+	off_t size;
+	vm_t *vm;
+	// Values of the global variables once the top level code has run, which every request
+	// starts from (strings are copies)
+	value_t *globals;
+	int global_count;
+} server_script_t;
+
+/**
+ * Runs the top level code of the scripts (from server_loadscripts()) once, then answers
+ * requests on a Unix domain socket until the process is stopped. The server takes over the
+ * scripts, which keep the settings of their vm_t's. Responses are flushed with the policy (0
+ * for OUTPUT_FLUSH_SIZE).
+ */
+int server_run(char *socketPath, list_t *scripts, output_flush_policy policy);
+
+/**
+ * Like server_run(), except that workerCount processes are kept waiting for requests, and a
+ * new one is forked every time one of them has answered a request.
+ */
+int server_prefork(char *socketPath, list_t *scripts, int workerCount,
+		output_flush_policy policy);
+
+/**
+ * Sends one request to a running server and copies its output to stdout, and its exceptions to
+ * stderr. Returns the number of errors the server reported (or -1 if the server couldn't be
+ * reached).
+ */
+int server_call(char *socketPath, char *request);
+
+/**
+ * Preprocesses every script, or returns NULL if any of them can't be loaded.
+ */
+list_t* server_loadscripts(char **scriptPaths, int scriptCount);
+void server_freescripts(list_t *scripts);
+/**
+ * Creates the listening socket, replacing a socket file left over from before.
+ */
+int server_listen(char *socketPath);
+/**
+ * Reads one request from the client, runs it and writes the response. With reset, the
+ * variables are first put back the way the top level code left them, so the request can't see
+ * what earlier requests left behind.
+ */
+void server_handle(int client, list_t *scripts, bool reset,
+		output_flush_policy policy);
+
+#endif /* SERVER_H_ */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * source.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef SOURCE_H_
+#define SOURCE_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "../include/stringobj.h"
+#include "../include/listobj.h"
+#include "../include/mapobj.h"
+#include "../include/interpreter.h"
+
+/*
+ * Where every function is in the source of a script, found by skimming the lines for function
+ * headers and functionends without parsing anything else. Every function gets a hash of its
+ * text, and the top level code gets one of its lines (together with their line numbers), so
+ * interpreter_reload() can tell which parts of a script changed since it was last loaded.
+ */
+
+typedef struct source_span_t {
+	string_t *name;
+	char *start, *end; // from the start of the header line to the end of the functionend line
+	int first_line, last_line;
+	unsigned int hash; // of the text from start to end
+} source_span_t;
+
+typedef struct source_map_t {
+	char *text; // the whole source, which the spans point into
+	size_t length;
+	list_t *spans; // source_span_t of every function, in the order of the source
+	map_t *names; // the same spans by name
+	unsigned int main_hash; // of the top level code
+	size_t main_length; // the number of bytes on the lines of the top level code
+	bool nested; // a function inside of another one (or a missing functionend)
+} source_map_t;
+
+/**
+ * Skims the source, which then belongs to the source_map_t.
+ */
+source_map_t* source_skim(char *text, size_t length, vm_t *vm);
+/**
+ * Reads the rest of the stream and skims it, or returns NULL if it can't be read.
+ */
+source_map_t* source_read(FILE *stream, vm_t *vm);
+source_span_t* source_findspan(string_t *name, source_map_t *source);
+/**
+ * Whether two spans have the same text. The hashes only rule out the ones that differ, so a
+ * collision can't pass for a function that didn't change.
+ */
+bool source_samespan(source_span_t *span, source_span_t *other);
+/**
+ * Whether the top level code of two sources is the same, line numbers and all. Top level code
+ * that only moved around between the functions counts as changed.
+ */
+bool source_samemain(source_map_t *source, source_map_t *other);
+void source_free(source_map_t *source);
+
+#endif /* SOURCE_H_ */
@@ -59,12 +59,18 @@ string_t *string_copyvalueof_s(string_t *src);
 void string_append(string_t *dest, char *src);
 void string_append_s(string_t *dest, string_t *src);
 
+/**
+ * Appends exactly length bytes of src, which does not need to be null terminated
+ * (like a line inside a memory mapped file).
+ */
+void string_appendn(string_t *dest, char *src, int length);
 void string_appendchar(string_t *dest, char letter);
 
 /**
- * Returns 2 strings that are split from the delimiters
+ * Returns 2 strings that are split from the first delimiter, or NULL if the delimiter is
+ * not present
  */
-string_t** string_split(char *delimiter);
+string_t** string_split(char delimiter, string_t *src);
 
 // Comparisons between strings
 bool string_equals(string_t *dest, char *src);
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * threadpool.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef struct threadpool_task {
+	void (*task)(void*);
+	void *arg;
+	struct threadpool_task *next;
+} threadpool_task_t;
+
+typedef struct {
+	pthread_t *threads;
+	int thread_count;
+
+	// Tasks waiting for a thread (first in, first out)
+	threadpool_task_t *queue_head, *queue_tail;
+	int pending_tasks; // queued + currently running
+
+	pthread_mutex_t lock;
+	pthread_cond_t task_available, tasks_done;
+	bool shutdown;
+} threadpool_t;
+
+/**
+ * Starts thread_count worker threads. If thread_count is zero or less, one thread per
+ * online processor is started.
+ */
+threadpool_t* threadpool_init(int thread_count);
+
+/**
+ * Queues task(arg) to be run on one of the worker threads.
+ */
+void threadpool_submit(void (*task)(void*), void *arg, threadpool_t *pool);
+
+/**
+ * Blocks until every task that has been submitted so far has finished running.
+ */
+void threadpool_wait(threadpool_t *pool);
+
+/**
+ * Waits for the queued tasks, then joins and frees the worker threads.
+ */
+void threadpool_free(threadpool_t *pool);
+
+int threadpool_cpucount();
+
+#endif /* THREADPOOL_H_ */
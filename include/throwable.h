@@ -30,6 +30,8 @@
 #ifndef THROWABLE_H_
 #define THROWABLE_H_
 
+#include <stdio.h>
+
 /*
  * This class is inspired from the Java's throwable class
  */
@@ -38,12 +40,21 @@
 typedef enum {
 	ERRNO_EXCEPTION = 1,
 	NULL_POINTER_EXCEPTION = 2,
-	INDEX_OUT_OF_BOUNDS_EXCEPTION = 3
+	INDEX_OUT_OF_BOUNDS_EXCEPTION = 3,
+	SYNTAX_EXCEPTION = 4,
+	STACK_OVERFLOW_EXCEPTION = 5
 } exception;
 
 /**
- * An exception will be displayed on console with the line number.
+ * An exception will be displayed on console with the line number (-1 for errors inside the
+ * interpreter itself, 0 for errors in something that isn't a line of the script, like the call
+ * of a request). Safe to call from multiple threads at once.
  */
 void throw_exception(exception e, int lineNum, char *message, ...);
+/**
+ * Until throw_capture(NULL), every exception (from any thread) is also written to the stream,
+ * one line each.
+ */
+void throw_capture(FILE *stream);
 
 #endif /* THROWABLE_H_ */
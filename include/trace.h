@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * trace.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/*
+ * A timeline of what a script waited on (freeze --trace trace.json script.fz), in the Chrome
+ * trace format that Perfetto and chrome://tracing open.
+ *
+ * Every event is a span: loading, preprocessing and cache hits or misses, every read and write
+ * (from the instruction until the file is done, on whatever thread did the work), every system
+ * or spawned command, every wait, and every call that took longer than the threshold. The
+ * events go into a ring buffer of the vm_t that any thread can add to without a lock, and the
+ * oldest events are overwritten once it's full.
+ */
+
+#define TRACE_DEFAULT_CAPACITY 16384 // events (a power of two)
+#define TRACE_DEFAULT_THRESHOLD 100000 // calls that take less nanoseconds than this are left out
+#define TRACE_NAME_SIZE 32
+#define TRACE_DETAIL_SIZE 96 // longer paths and commands are cut off
+
+typedef enum {
+	TRACE_PHASE, TRACE_IO, TRACE_PROCESS, TRACE_CALL
+} trace_category;
+
+typedef struct {
+	trace_category category;
+	char name[TRACE_NAME_SIZE];
+	char detail[TRACE_DETAIL_SIZE]; // the path or command, empty if there is none
+	int line_num; // of the instruction, -1 if the event doesn't belong to a line
+	int thread;
+	long long started, duration; // in nanoseconds (see trace_now())
+} trace_event_t;
+
+typedef struct {
+	atomic_ulong sequence; // the index of the event plus one, once it is complete
+	trace_event_t event;
+} trace_slot_t;
+
+typedef struct trace_t {
+	trace_slot_t *slots;
+	unsigned long capacity;
+	atomic_ulong next; // index of the next event (the slot is this modulo the capacity)
+	long long call_threshold; // in nanoseconds
+	long long origin; // when the trace started
+	int thread; // that started the trace, which runs the script
+} trace_t;
+
+trace_t* trace_init(unsigned long capacity, long long callThreshold);
+long long trace_now(void);
+/**
+ * Adds a span between two trace_now() times. Any thread can call this, and it never blocks or
+ * allocates.
+ */
+void trace_add(trace_category category, const char *name, const char *detail,
+		int lineNum, long long started, long long finished, trace_t *trace);
+// Adds a span from started until now
+void trace_span(trace_category category, const char *name, const char *detail,
+		int lineNum, long long started, trace_t *trace);
+/**
+ * Writes the events in the Chrome trace format. Nothing can add events while this runs.
+ */
+void trace_write(FILE *stream, trace_t *trace);
+void trace_free(trace_t *trace);
+
+#endif /* TRACE_H_ */
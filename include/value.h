@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * value.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#ifndef VALUE_H_
+#define VALUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "../include/stringobj.h"
+#include "../deps/tinyexpr/tinyexpr.h"
+
+/*
+ * The value of a variable (or of an argument on the slot stack) in 8 bytes.
+ *
+ * A number is stored as itself, so tinyexpr and the JIT read the address of a variable as a
+ * double like before. A string is a quiet NaN that has the pointer to its string_t in the low
+ * 48 bits, below a tag that no arithmetic ever produces: reading a string as a number gives
+ * NaN, just like the NAN strings used to have, and the type is in the value instead of next to
+ * it. Every NaN that is stored goes through value_number(), so a NaN that an expression made
+ * out of a string can't be mistaken for one.
+ *
+ * Numbers are 0 bits, so memory from calloc() holds the number 0.
+ */
+
+typedef union {
+	double number;
+	uint64_t bits;
+} value_t;
+
+#define VALUE_TAG_MASK 0xFFFF000000000000ULL
+#define VALUE_STRING_TAG 0x7FFC000000000000ULL
+#define VALUE_OBJECT_TAG 0x7FFD000000000000ULL // for OBJECT_TYPE, which has no values yet
+#define VALUE_POINTER_MASK 0x0000FFFFFFFFFFFFULL
+#define VALUE_NAN 0x7FF8000000000000ULL
+
+static inline value_t value_number(double number) {
+	value_t value = { .number = number };
+	if (number != number)
+		value.bits = VALUE_NAN;
+	return value;
+}
+
+// Takes over the string
+static inline value_t value_string(string_t *text) {
+	value_t value = { .bits = VALUE_STRING_TAG | (uintptr_t) text };
+	return value;
+}
+
+static inline bool value_isstring(value_t value) {
+	return (value.bits & VALUE_TAG_MASK) == VALUE_STRING_TAG;
+}
+
+static inline string_t* value_text(value_t value) {
+	return (string_t*) (uintptr_t) (value.bits & VALUE_POINTER_MASK);
+}
+
+static inline enum Type value_type(value_t value) {
+	return value_isstring(value) ? STRING_TYPE : DOUBLE_TYPE;
+}
+
+// Frees the string of a value, which leaves the number 0
+static inline void value_clear(value_t *value) {
+	if (value_isstring(*value))
+		string_free(value_text(*value));
+	value->bits = 0;
+}
+
+// Frees whatever the value held before
+static inline void value_set(value_t *dest, value_t value) {
+	if (value_isstring(*dest))
+		string_free(value_text(*dest));
+	*dest = value;
+}
+
+#endif /* VALUE_H_ */
@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * asyncio.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "../include/asyncio.h"
+#include "../include/stringobj.h"
+#include "../include/listobj.h"
+#include "../include/memstats.h"
+#include "../include/threadpool.h"
+#include "../include/trace.h"
+
+// Static Prototypes
+static asyncio_request_t* asyncio_request_init(asyncio_kind kind, char *path,
+		string_t *data, void *context, int line_num, asyncio_t *io);
+static void asyncio_start(asyncio_request_t *request, asyncio_t *io);
+static void asyncio_begin(asyncio_request_t *request, asyncio_t *io);
+static asyncio_request_t* asyncio_finish(asyncio_request_t *request,
+		int error);
+static void asyncio_reserve(string_t *data, int extra);
+static void asyncio_runblocking(void *request);
+static asyncio_uring_t* asyncio_uring_init();
+static void asyncio_uring_free(asyncio_uring_t *uring);
+static void asyncio_uring_submit(asyncio_t *io);
+static void asyncio_uring_enter(unsigned waitCount, asyncio_t *io);
+static void asyncio_uring_fallback(asyncio_t *io);
+static void asyncio_uring_reap(bool wait, asyncio_t *io);
+static void asyncio_uring_complete(asyncio_request_t *request, int result,
+		asyncio_t *io);
+static void asyncio_uring_finish(asyncio_request_t *request, int error,
+		asyncio_t *io);
+
+asyncio_t* asyncio_init(bool allowUring) {
+	asyncio_t *io = malloc(sizeof(asyncio_t));
+
+	io->uring = allowUring ? asyncio_uring_init() : NULL;
+	io->pool = io->uring == NULL ? threadpool_init(ASYNCIO_THREADS) : NULL;
+
+	io->requests = list_init();
+	io->submit_head = NULL;
+	io->submit_tail = NULL;
+	pthread_mutex_init(&io->lock, NULL);
+	io->trace = NULL;
+
+	return io;
+}
+
+asyncio_request_t* asyncio_read(char *path, void *context, int line_num,
+		asyncio_t *io) {
+	asyncio_request_t *request = asyncio_request_init(ASYNCIO_READ, path,
+			string_init(), context, line_num, io);
+	asyncio_start(request, io);
+	return request;
+}
+
+asyncio_request_t* asyncio_write(char *path, string_t *data, void *context,
+		int line_num, asyncio_t *io) {
+	asyncio_request_t *request = asyncio_request_init(ASYNCIO_WRITE, path,
+			data, context, line_num, io);
+	asyncio_start(request, io);
+	return request;
+}
+
+list_t* asyncio_wait(asyncio_t *io) {
+	// Once the thread pool has taken over, the ring only has to finish what it still has
+	if (io->uring != NULL) {
+		while (io->pool == NULL ?
+				asyncio_pending(io) : io->uring->in_flight > 0) {
+			asyncio_uring_submit(io);
+			asyncio_uring_reap(true, io);
+		}
+	}
+	if (io->pool != NULL)
+		threadpool_wait(io->pool);
+
+	list_t *finished = io->requests;
+	io->requests = list_init();
+	return finished;
+}
+
+bool asyncio_pending(asyncio_t *io) {
+	pthread_mutex_lock(&io->lock);
+	bool pending = false;
+	for (int i = 0; i < io->requests->data_length && !pending; i++)
+		pending = !((asyncio_request_t*) io->requests->data[i])->done;
+	pthread_mutex_unlock(&io->lock);
+	return pending;
+}
+
+void asyncio_request_free(void *request) {
+	free(((asyncio_request_t*) request)->path);
+	// The data of a read is usually taken over by whoever made the request
+	if (((asyncio_request_t*) request)->data != NULL)
+		string_free(((asyncio_request_t*) request)->data);
+	memstats_free(request, MEMSTATS_IO);
+}
+
+void asyncio_free(asyncio_t *io) {
+	list_complete_free(&asyncio_request_free, asyncio_wait(io));
+	list_free(io->requests);
+
+	if (io->uring != NULL)
+		asyncio_uring_free(io->uring);
+	if (io->pool != NULL)
+		threadpool_free(io->pool);
+	pthread_mutex_destroy(&io->lock);
+	free(io);
+}
+
+static asyncio_request_t* asyncio_request_init(asyncio_kind kind, char *path,
+		string_t *data, void *context, int line_num, asyncio_t *io) {
+	asyncio_request_t *request = memstats_malloc(sizeof(asyncio_request_t),
+			MEMSTATS_IO);
+
+	request->kind = kind;
+	request->path = strdup(path);
+	request->data = data;
+	request->context = context;
+	request->line_num = line_num;
+	request->error = 0;
+	request->done = false;
+	request->started = io->trace != NULL ? trace_now() : 0;
+
+	request->io = io;
+	request->fd = -1;
+	request->offset = 0;
+	request->opened = false;
+	request->next_same_path = NULL;
+	request->next_submit = NULL;
+	return request;
+}
+
+/**
+ * Starts the request, unless an unfinished request on the same path has to finish first.
+ */
+static void asyncio_start(asyncio_request_t *request, asyncio_t *io) {
+	pthread_mutex_lock(&io->lock);
+	asyncio_request_t *previous = NULL;
+	for (int i = io->requests->data_length - 1; i >= 0 && previous == NULL;
+			i--) {
+		asyncio_request_t *other = io->requests->data[i];
+		if (!other->done && strcmp(other->path, request->path) == 0)
+			previous = other;
+	}
+	if (previous != NULL)
+		previous->next_same_path = request;
+	list_add(request, io->requests);
+	pthread_mutex_unlock(&io->lock);
+
+	if (previous == NULL)
+		asyncio_begin(request, io);
+	else if (io->uring != NULL)
+		asyncio_uring_reap(false, io); // the previous one might already be done
+}
+
+static void asyncio_begin(asyncio_request_t *request, asyncio_t *io) {
+	if (io->pool != NULL) {
+		threadpool_submit(&asyncio_runblocking, request, io->pool);
+		return;
+	}
+
+	if (io->submit_tail == NULL)
+		io->submit_head = request;
+	else
+		io->submit_tail->next_submit = request;
+	io->submit_tail = request;
+	asyncio_uring_submit(io);
+}
+
+/**
+ * Returns the request on the same path that can start now (or NULL), for the caller to start.
+ */
+static asyncio_request_t* asyncio_finish(asyncio_request_t *request,
+		int error) {
+	if (request->error == 0)
+		request->error = error;
+	if (request->fd != -1) {
+		if (close(request->fd) == -1 && request->error == 0)
+			request->error = errno;
+		request->fd = -1;
+	}
+
+	// Once it is done, the request can be freed by the thread that waits for it
+	asyncio_t *io = request->io;
+	if (io->trace != NULL)
+		trace_span(TRACE_IO, request->kind == ASYNCIO_READ ? "read" : "write",
+				request->path, request->line_num, request->started, io->trace);
+	// asyncio_start() links new requests under the lock, so this read is up to date
+	pthread_mutex_lock(&io->lock);
+	request->done = true;
+	asyncio_request_t *next = request->next_same_path;
+	pthread_mutex_unlock(&io->lock);
+	return next;
+}
+
+static void asyncio_reserve(string_t *data, int extra) {
+	if (data->text_length + extra + 1 <= data->text_allocated_length)
+		return;
+	memstats_capacity(MEMSTATS_STRINGS,
+			data->text_length + extra + 1 - data->text_allocated_length, 0);
+	data->text_allocated_length = data->text_length + extra + 1;
+	data->text = memstats_realloc(data->text, data->text_allocated_length,
+			MEMSTATS_STRINGS);
+}
+
+// Thread Pool
+static void asyncio_runblocking(void *arg) {
+	asyncio_request_t *request = arg;
+	while (request != NULL) {
+		int error = 0;
+		// A request that io_uring gave up on goes on from where it was (its reads and writes
+		// had their own offsets, so the file position is still at the start)
+		if (request->opened)
+			lseek(request->fd, request->kind == ASYNCIO_READ ?
+					request->data->text_length : request->offset, SEEK_SET);
+		if (request->kind == ASYNCIO_READ) {
+			if (!request->opened)
+				request->fd = open(request->path, O_RDONLY | O_CLOEXEC);
+			ssize_t readCount = -1;
+			while (request->fd != -1) {
+				asyncio_reserve(request->data, ASYNCIO_READ_SIZE);
+				readCount = read(request->fd,
+						request->data->text + request->data->text_length,
+						ASYNCIO_READ_SIZE);
+				if (readCount <= 0)
+					break;
+				request->data->text_length += readCount;
+				memstats_capacity(MEMSTATS_STRINGS, 0, readCount);
+			}
+			request->data->text[request->data->text_length] = '\0';
+			if (request->fd == -1 || readCount == -1)
+				error = errno;
+		} else {
+			if (!request->opened)
+				request->fd = open(request->path,
+				O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+			while (request->fd != -1
+					&& request->offset < request->data->text_length) {
+				ssize_t writeCount = write(request->fd,
+						request->data->text + request->offset,
+						request->data->text_length - request->offset);
+				if (writeCount == -1) {
+					error = errno;
+					break;
+				}
+				request->offset += writeCount;
+			}
+			if (request->fd == -1)
+				error = errno;
+		}
+
+		// The rest of the chain runs on this thread
+		request = asyncio_finish(request, error);
+	}
+}
+
+// io_uring (without liburing, just the system calls)
+static asyncio_uring_t* asyncio_uring_init() {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	int fd = syscall(__NR_io_uring_setup, ASYNCIO_URING_ENTRIES, &params);
+	if (fd == -1)
+		return NULL; // not supported, or not allowed (like inside some containers)
+
+	// Reading at the current file position (Linux 5.6) also means that openat is supported
+	if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+		close(fd);
+		return NULL;
+	}
+
+	asyncio_uring_t *uring = malloc(sizeof(asyncio_uring_t));
+	uring->fd = fd;
+	uring->in_flight = 0;
+	uring->sq_ring_size = params.sq_off.array
+			+ params.sq_entries * sizeof(unsigned);
+	uring->cq_ring_size = params.cq_off.cqes
+			+ params.cq_entries * sizeof(struct io_uring_cqe);
+	uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	uring->sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE,
+	MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	uring->cq_ring = mmap(NULL, uring->cq_ring_size, PROT_READ | PROT_WRITE,
+	MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE,
+	MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (uring->sq_ring == MAP_FAILED || uring->cq_ring == MAP_FAILED
+			|| uring->sqes == MAP_FAILED) {
+		asyncio_uring_free(uring);
+		return NULL;
+	}
+
+	char *sq = uring->sq_ring, *cq = uring->cq_ring;
+	uring->sq_head = (unsigned*) (sq + params.sq_off.head);
+	uring->sq_tail = (unsigned*) (sq + params.sq_off.tail);
+	uring->sq_mask = (unsigned*) (sq + params.sq_off.ring_mask);
+	uring->sq_array = (unsigned*) (sq + params.sq_off.array);
+	uring->cq_head = (unsigned*) (cq + params.cq_off.head);
+	uring->cq_tail = (unsigned*) (cq + params.cq_off.tail);
+	uring->cq_mask = (unsigned*) (cq + params.cq_off.ring_mask);
+	uring->cqes = cq + params.cq_off.cqes;
+
+	return uring;
+}
+
+static void asyncio_uring_free(asyncio_uring_t *uring) {
+	if (uring->sq_ring != MAP_FAILED)
+		munmap(uring->sq_ring, uring->sq_ring_size);
+	if (uring->cq_ring != MAP_FAILED)
+		munmap(uring->cq_ring, uring->cq_ring_size);
+	if (uring->sqes != MAP_FAILED)
+		munmap(uring->sqes, uring->sqes_size);
+	close(uring->fd);
+	free(uring);
+}
+
+/**
+ * Puts the next step of every waiting request into the ring (a request only ever has one step
+ * in flight), for as long as there is space.
+ */
+static void asyncio_uring_submit(asyncio_t *io) {
+	if (io->pool != NULL)
+		return; // io_uring has stopped working
+	asyncio_uring_t *uring = io->uring;
+	unsigned tail = *uring->sq_tail;
+	unsigned count = 0;
+
+	while (io->submit_head != NULL
+			&& uring->in_flight + count < ASYNCIO_URING_ENTRIES) {
+		asyncio_request_t *request = io->submit_head;
+		io->submit_head = request->next_submit;
+		if (io->submit_head == NULL)
+			io->submit_tail = NULL;
+		request->next_submit = NULL;
+
+		unsigned index = (tail + count) & *uring->sq_mask;
+		struct io_uring_sqe *sqe = (struct io_uring_sqe*) uring->sqes + index;
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->user_data = (unsigned long) request;
+
+		if (!request->opened) {
+			sqe->opcode = IORING_OP_OPENAT;
+			sqe->fd = AT_FDCWD;
+			sqe->addr = (unsigned long) request->path;
+			if (request->kind == ASYNCIO_READ) {
+				sqe->open_flags = O_RDONLY | O_CLOEXEC;
+			} else {
+				sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+				sqe->len = 0644;
+			}
+		} else if (request->kind == ASYNCIO_READ) {
+			asyncio_reserve(request->data, ASYNCIO_READ_SIZE);
+			sqe->opcode = IORING_OP_READ;
+			sqe->fd = request->fd;
+			sqe->addr = (unsigned long) (request->data->text
+					+ request->data->text_length);
+			sqe->len = request->data->text_allocated_length
+					- request->data->text_length - 1;
+			sqe->off = request->data->text_length;
+		} else {
+			sqe->opcode = IORING_OP_WRITE;
+			sqe->fd = request->fd;
+			sqe->addr = (unsigned long) (request->data->text + request->offset);
+			sqe->len = request->data->text_length - request->offset;
+			sqe->off = request->offset;
+		}
+		uring->sq_array[index] = index;
+		count++;
+	}
+	__atomic_store_n(uring->sq_tail, tail + count, __ATOMIC_RELEASE);
+	uring->in_flight += count;
+	asyncio_uring_enter(0, io);
+}
+
+/**
+ * Hands every entry the kernel hasn't taken yet over to it, and waits until at least waitCount
+ * of them are done. Entries the kernel has no room for stay in the ring until the next call.
+ * Any other error moves the requests over to the thread pool (see asyncio_uring_fallback()).
+ */
+static void asyncio_uring_enter(unsigned waitCount, asyncio_t *io) {
+	asyncio_uring_t *uring = io->uring;
+	for (;;) {
+		unsigned submitCount = *uring->sq_tail
+				- __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+		if (submitCount == 0 && waitCount == 0)
+			return;
+		long entered = syscall(__NR_io_uring_enter, uring->fd, submitCount,
+				waitCount, waitCount > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if (entered == -1 && errno == EINTR)
+			continue;
+		if (entered == -1 && (errno == EAGAIN || errno == EBUSY))
+			return; // reaping what is done makes room
+		if (entered == -1 || (entered == 0 && submitCount > 0)) {
+			asyncio_uring_fallback(io);
+			return;
+		}
+		// The kernel can take fewer entries than it was given
+		if (entered == submitCount)
+			return;
+		waitCount = 0;
+	}
+}
+
+/**
+ * Moves the steps the kernel never took, and every step after them, over to a thread pool. The
+ * ring only finishes the steps it already has.
+ */
+static void asyncio_uring_fallback(asyncio_t *io) {
+	asyncio_uring_t *uring = io->uring;
+	io->pool = threadpool_init(ASYNCIO_THREADS);
+
+	unsigned head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+	unsigned tail = *uring->sq_tail;
+	for (unsigned i = head; i != tail; i++) {
+		struct io_uring_sqe *sqe = (struct io_uring_sqe*) uring->sqes
+				+ uring->sq_array[i & *uring->sq_mask];
+		threadpool_submit(&asyncio_runblocking, (void*) sqe->user_data, io->pool);
+	}
+	__atomic_store_n(uring->sq_tail, head, __ATOMIC_RELEASE);
+	uring->in_flight -= tail - head;
+
+	while (io->submit_head != NULL) {
+		asyncio_request_t *request = io->submit_head;
+		io->submit_head = request->next_submit;
+		request->next_submit = NULL;
+		threadpool_submit(&asyncio_runblocking, request, io->pool);
+	}
+	io->submit_tail = NULL;
+}
+
+static void asyncio_uring_reap(bool wait, asyncio_t *io) {
+	asyncio_uring_t *uring = io->uring;
+	if (wait && uring->in_flight > 0)
+		asyncio_uring_enter(1, io);
+
+	unsigned head = *uring->cq_head;
+	unsigned tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+	while (head != tail) {
+		struct io_uring_cqe *cqe = (struct io_uring_cqe*) uring->cqes
+				+ (head & *uring->cq_mask);
+		asyncio_request_t *request = (asyncio_request_t*) cqe->user_data;
+		int result = cqe->res;
+		head++;
+		__atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+		uring->in_flight--;
+
+		asyncio_uring_complete(request, result, io);
+	}
+	asyncio_uring_submit(io);
+}
+
+/**
+ * Moves a request on to its next step: open, then read or write until it's all done.
+ */
+static void asyncio_uring_complete(asyncio_request_t *request, int result,
+		asyncio_t *io) {
+	if (result < 0) {
+		asyncio_uring_finish(request, -result, io);
+		return;
+	}
+
+	if (!request->opened) {
+		request->fd = result;
+		request->opened = true;
+
+		// The size is just a guess for the buffer, the read goes on until the end of the file
+		struct stat info;
+		if (request->kind == ASYNCIO_READ && fstat(request->fd, &info) == 0)
+			asyncio_reserve(request->data, info.st_size);
+	} else if (request->kind == ASYNCIO_READ) {
+		if (result == 0) {
+			request->data->text[request->data->text_length] = '\0';
+			asyncio_uring_finish(request, 0, io);
+			return;
+		}
+		request->data->text_length += result;
+		memstats_capacity(MEMSTATS_STRINGS, 0, result);
+	} else {
+		request->offset += result;
+		if (request->offset >= request->data->text_length) {
+			asyncio_uring_finish(request, 0, io);
+			return;
+		}
+	}
+
+	if (io->pool != NULL) {
+		threadpool_submit(&asyncio_runblocking, request, io->pool);
+		return;
+	}
+	request->next_submit = NULL;
+	if (io->submit_tail == NULL)
+		io->submit_head = request;
+	else
+		io->submit_tail->next_submit = request;
+	io->submit_tail = request;
+}
+
+static void asyncio_uring_finish(asyncio_request_t *request, int error,
+		asyncio_t *io) {
+	asyncio_request_t *next = asyncio_finish(request, error);
+	if (next != NULL)
+		asyncio_begin(next, io);
+}
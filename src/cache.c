@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * cache.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../include/cache.h"
+#include "../include/interpreter.h"
+#include "../include/stringobj.h"
+#include "../include/listobj.h"
+#include "../include/memstats.h"
+
+// Everything a cache file has to match before it is used
+typedef struct {
+	char magic[4];
+	int32_t version;
+	int64_t source_size, source_seconds, source_nanoseconds;
+	char set_delimiter, arg_delimiter, comment_delimiter;
+} cache_header_t;
+
+// Static Prototypes
+static void cache_header(cache_header_t *header, struct stat *source,
+		vm_t *vm);
+static bool cache_validjumps(list_t *functions);
+
+static void cache_savestring(void *str, FILE *stream);
+static void cache_savefunction(void *funct, FILE *stream);
+static void cache_saveinstruction(void *instr, FILE *stream);
+static void* cache_loadstring(FILE *stream);
+static void* cache_loadfunction(FILE *stream);
+static void* cache_loadinstruction(FILE *stream);
+
+void cache_preprocess(FILE *stream, char *scriptPath, vm_t *vm) {
+	struct stat source;
+	if (fstat(fileno(stream), &source) != 0 || !S_ISREG(source.st_mode)) {
+		interpreter_preprocessfile(stream, vm);
+		return;
+	}
+
+	int pathLength = strlen(scriptPath);
+	char *cachePath = malloc(pathLength + sizeof(CACHE_EXTENSION) + 32);
+	sprintf(cachePath, "%s%s", scriptPath, CACHE_EXTENSION);
+
+	long long started = vm->trace != NULL ? trace_now() : 0;
+	FILE *cache = fopen(cachePath, "rb");
+	bool loaded = cache != NULL && cache_load(cache, &source, vm);
+	if (cache != NULL)
+		fclose(cache);
+	if (vm->trace != NULL)
+		trace_span(TRACE_PHASE, loaded ? "cache hit" : "cache miss",
+				cachePath, -1, started, vm->trace);
+
+	if (!loaded) {
+		interpreter_preprocessfile(stream, vm);
+
+		// Written under another name first, so no one ever reads half of a cache file
+		char *tempPath = malloc(pathLength + sizeof(CACHE_EXTENSION) + 32);
+		sprintf(tempPath, "%s.%ld", cachePath, (long) getpid());
+		started = vm->trace != NULL ? trace_now() : 0;
+		if (vm->error_count == 0 && (cache = fopen(tempPath, "wb")) != NULL) {
+			bool saved = cache_save(cache, &source, vm);
+			if (fclose(cache) == 0 && saved)
+				rename(tempPath, cachePath);
+			else
+				remove(tempPath); // a missing cache file only makes the next run slower
+			if (vm->trace != NULL)
+				trace_span(TRACE_PHASE, "cache write", cachePath, -1, started,
+						vm->trace);
+		}
+		free(tempPath);
+	}
+	free(cachePath);
+}
+
+bool cache_load(FILE *cache, struct stat *source, vm_t *vm) {
+	cache_header_t expected, actual;
+	cache_header(&expected, source, vm);
+	if (fread(&actual, sizeof(cache_header_t), 1, cache) != 1
+			|| memcmp(&expected, &actual, sizeof(cache_header_t)) != 0)
+		return false;
+
+	list_t *functions = list_deserialize(&cache_loadfunction, cache);
+	// The magic number is repeated at the end, so a cut off file is noticed
+	char end[sizeof(expected.magic)];
+	if (ferror(cache) || fread(end, sizeof(end), 1, cache) != 1
+			|| memcmp(end, expected.magic, sizeof(end)) != 0
+			|| functions->data_length == 0 || !cache_validjumps(functions)) {
+		list_complete_free(&function_free, functions);
+		return false;
+	}
+
+	list_complete_free(&function_free, vm->function_list);
+	vm->function_list = functions;
+	interpreter_indexfunctions(vm);
+	interpreter_optimize(vm); // opcodes depend on the keywords of the vm_t, so they aren't saved
+	return true;
+}
+
+bool cache_save(FILE *cache, struct stat *source, vm_t *vm) {
+	cache_header_t header;
+	cache_header(&header, source, vm);
+	fwrite(&header, sizeof(cache_header_t), 1, cache);
+	interpreter_loadall(vm); // the cache has every function parsed
+	list_serialize(&cache_savefunction, cache, vm->function_list);
+	fwrite(header.magic, sizeof(header.magic), 1, cache);
+	return !ferror(cache);
+}
+
+static void cache_header(cache_header_t *header, struct stat *source,
+		vm_t *vm) {
+	// Zeroed, so the padding can be compared with memcmp()
+	memset(header, 0, sizeof(cache_header_t));
+	memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+	header->version = CACHE_VERSION;
+	header->source_size = source->st_size;
+	header->source_seconds = source->st_mtim.tv_sec;
+	header->source_nanoseconds = source->st_mtim.tv_nsec;
+	header->set_delimiter = vm->set_delimiter;
+	header->arg_delimiter = vm->arg_delimiter;
+	header->comment_delimiter = vm->comment_delimiter;
+}
+
+// A damaged jump target would run instructions that don't exist
+static bool cache_validjumps(list_t *functions) {
+	for (int i = 0; i < functions->data_length; i++) {
+		list_t *instructions =
+				((function_t*) functions->data[i])->parsed_instructions;
+		for (int j = 0; j < instructions->data_length; j++) {
+			int target =
+					((parsed_instruction_t*) instructions->data[j])->jump_index;
+			if (target < PARSE_JUMP_UNRESOLVED
+					|| target >= instructions->data_length)
+				return false;
+		}
+	}
+	return true;
+}
+
+static void cache_savestring(void *str, FILE *stream) {
+	string_serialize(str, stream);
+}
+
+static void cache_savefunction(void *funct, FILE *stream) {
+	function_t *function = funct;
+	string_serialize(function->name, stream);
+	list_serialize(&cache_savestring, stream, function->args);
+	list_serialize(&cache_saveinstruction, stream,
+			function->parsed_instructions);
+}
+
+// Compiled expressions point into the variables of a run, so they are compiled again
+static void cache_saveinstruction(void *instr, FILE *stream) {
+	parsed_instruction_t *instruction = instr;
+	string_serialize(instruction->name, stream);
+	list_serialize(&cache_savestring, stream, instruction->args);
+	int32_t numbers[3] = { instruction->line_num, instruction->jump_index,
+			instruction->tail_call };
+	fwrite(numbers, sizeof(numbers), 1, stream);
+}
+
+static void* cache_loadstring(FILE *stream) {
+	return string_deserialize(stream);
+}
+
+static void* cache_loadfunction(FILE *stream) {
+	string_t *name = string_deserialize(stream);
+	function_t *funct = function_init(name,
+			list_deserialize(&cache_loadstring, stream));
+	list_free(funct->parsed_instructions);
+	funct->parsed_instructions = list_deserialize(&cache_loadinstruction,
+			stream);
+	return funct;
+}
+
+static void* cache_loadinstruction(FILE *stream) {
+	parsed_instruction_t *instr = memstats_malloc(sizeof(parsed_instruction_t),
+			MEMSTATS_INSTRUCTIONS);
+	instr->name = string_deserialize(stream);
+	instr->args = list_deserialize(&cache_loadstring, stream);
+	instr->compiled_args = NULL;
+	instr->native_args = NULL;
+	instr->evaluation_count = 0;
+	instr->integer_args = 0;
+	instr->call_target = NULL;
+	instr->call_generation = 0;
+	instr->opcode = OP_UNKNOWN;
+	instr->target_variable = NULL;
+	instr->run_count = 0;
+	instr->profile_nanoseconds = 0;
+
+	int32_t numbers[3] = { 0, PARSE_JUMP_UNRESOLVED, false };
+	if (fread(numbers, sizeof(numbers), 1, stream) != 1)
+		numbers[1] = PARSE_JUMP_UNRESOLVED;
+	instr->line_num = numbers[0];
+	instr->jump_index = numbers[1];
+	instr->tail_call = numbers[2] != 0;
+	return instr;
+}
@@ -0,0 +1,1219 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * emitc.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <limits.h>
+
+#include "../include/emitc.h"
+#include "../include/interpreter.h"
+#include "../include/intexpr.h"
+#include "../include/stringobj.h"
+#include "../include/listobj.h"
+#include "../include/throwable.h"
+#include "../deps/tinyexpr/tinyexpr.h"
+
+#define EMITC_TYPE_MASK(TYPE) ((TYPE) & 0x1F)
+#define EMITC_ARITY(TYPE) ((TYPE) & 0x07)
+
+// Bytes of C stack for every call (and every local of the biggest function)
+#define EMITC_FRAME_SIZE 1024
+#define EMITC_LOCAL_SIZE 64
+
+/*
+ * What the generated program starts with (after FZ_MAX_DEPTH and FZ_STACK_SIZE): the value
+ * type, and everything the instructions turn into that is more than a line of C.
+ */
+static const char *emitc_runtime[] = {
+		"#include <stdio.h>",
+		"#include <stdlib.h>",
+		"#include <stdarg.h>",
+		"#include <string.h>",
+		"#include <errno.h>",
+		"#include <limits.h>",
+		"#include <math.h>",
+		"#include <pthread.h>",
+		"#include <sys/wait.h>",
+		"",
+		"typedef struct {",
+		"\tsize_t length, capacity;",
+		"\tchar data[];",
+		"} fz_string;",
+		"",
+		"/* A string has a NaN number, like in the interpreter */",
+		"typedef struct {",
+		"\tdouble number;",
+		"\tfz_string *text; /* NULL for numbers */",
+		"} fz_value;",
+		"",
+		"#define FZ_NUMBER(N) ((fz_value) { (N), NULL })",
+		"",
+		"static inline void fz_fail(int line, const char *kind, const char *format, ...) {",
+		"\tint errorNumber = errno;",
+		"\tfflush(stdout);",
+		"\tfprintf(stderr, \"Line #%d [\", line);",
+		"\tva_list args;",
+		"\tva_start(args, format);",
+		"\tvfprintf(stderr, format, args);",
+		"\tva_end(args);",
+		"\tfprintf(stderr, \"]: %s\\n\", kind != NULL ? kind : strerror(errorNumber));",
+		"\texit(EXIT_FAILURE);",
+		"}",
+		"",
+		"static inline void fz_append(fz_value *dest, const char *text, size_t length) {",
+		"\tfz_string *str = dest->text;",
+		"\tif (str->length + length + 1 > str->capacity) {",
+		"\t\tsize_t capacity = str->capacity * 2;",
+		"\t\tif (capacity < str->length + length + 1)",
+		"\t\t\tcapacity = str->length + length + 1;",
+		"\t\tstr = realloc(str, sizeof(fz_string) + capacity);",
+		"\t\tif (str == NULL)",
+		"\t\t\tfz_fail(-1, NULL, \"Out of memory\");",
+		"\t\tstr->capacity = capacity;",
+		"\t\tdest->text = str;",
+		"\t}",
+		"\tmemcpy(str->data + str->length, text, length);",
+		"\tstr->length += length;",
+		"\tstr->data[str->length] = '\\0';",
+		"}",
+		"",
+		"static inline fz_value fz_text(const char *text, size_t length) {",
+		"\tfz_value value = { NAN, malloc(sizeof(fz_string) + length + 1) };",
+		"\tif (value.text == NULL)",
+		"\t\tfz_fail(-1, NULL, \"Out of memory\");",
+		"\tvalue.text->length = 0;",
+		"\tvalue.text->capacity = length + 1;",
+		"\tfz_append(&value, text, length);",
+		"\treturn value;",
+		"}",
+		"",
+		"static inline fz_value fz_copy(const fz_value *value) {",
+		"\tif (value->text == NULL)",
+		"\t\treturn FZ_NUMBER(value->number);",
+		"\treturn fz_text(value->text->data, value->text->length);",
+		"}",
+		"",
+		"static inline void fz_free(fz_value *value) {",
+		"\tfree(value->text);",
+		"\tvalue->text = NULL;",
+		"}",
+		"",
+		"/* Every fz_value passed to a function is owned (and freed) by it */",
+		"static inline void fz_set(fz_value *dest, fz_value value) {",
+		"\tfree(dest->text);",
+		"\t*dest = value;",
+		"}",
+		"",
+		"static inline void fz_setnumber(fz_value *dest, double number) {",
+		"\tif (dest->text != NULL)",
+		"\t\tfz_free(dest);",
+		"\tdest->number = number;",
+		"}",
+		"",
+		"static inline void fz_appendvalue(fz_value *dest, fz_value value) {",
+		"\tif (value.text != NULL) {",
+		"\t\tfz_append(dest, value.text->data, value.text->length);",
+		"\t\tfree(value.text);",
+		"\t} else {",
+		"\t\tchar number[32];",
+		"\t\tfz_append(dest, number,",
+		"\t\t\t\tsnprintf(number, sizeof(number), \"%.15g\", value.number));",
+		"\t}",
+		"}",
+		"",
+		"/* Numbers are added, anything is appended to strings */",
+		"static inline void fz_addvalue(fz_value *dest, fz_value value) {",
+		"\tif (dest->text != NULL) {",
+		"\t\tfz_appendvalue(dest, value);",
+		"\t} else {",
+		"\t\tdest->number += value.number;",
+		"\t\tfree(value.text);",
+		"\t}",
+		"}",
+		"",
+		"static inline void fz_addnumber(fz_value *dest, double number) {",
+		"\tif (dest->text != NULL)",
+		"\t\tfz_appendvalue(dest, FZ_NUMBER(number));",
+		"\telse",
+		"\t\tdest->number += number;",
+		"}",
+		"",
+		"static inline fz_value fz_needstring(int line, fz_value value, const char *arg) {",
+		"\tif (value.text == NULL)",
+		"\t\tfz_fail(line, \"SyntaxException\", \"Expected a string, but got %s!\", arg);",
+		"\treturn value;",
+		"}",
+		"",
+		"static inline void fz_printtext(const char *text, size_t length) {",
+		"\tfwrite(text, 1, length, stdout);",
+		"}",
+		"",
+		"static inline void fz_printnumber(double number) {",
+		"\tprintf(\"%.15g\", number);",
+		"}",
+		"",
+		"static inline void fz_printvalue(const fz_value *value) {",
+		"\tif (value->text != NULL)",
+		"\t\tfz_printtext(value->text->data, value->text->length);",
+		"\telse",
+		"\t\tfz_printnumber(value->number);",
+		"}",
+		"",
+		"static inline void fz_readstream(fz_value *dest, FILE *stream) {",
+		"\tchar buffer[4096];",
+		"\tsize_t length;",
+		"\tfz_set(dest, fz_text(\"\", 0));",
+		"\twhile ((length = fread(buffer, 1, sizeof(buffer), stream)) > 0)",
+		"\t\tfz_append(dest, buffer, length);",
+		"}",
+		"",
+		"static inline void fz_read(int line, fz_value *dest, fz_value path) {",
+		"\tFILE *file = fopen(path.text->data, \"rb\");",
+		"\tif (file == NULL)",
+		"\t\tfz_fail(line, NULL, \"Unable to read %s\", path.text->data);",
+		"\tfz_readstream(dest, file);",
+		"\tfclose(file);",
+		"\tfree(path.text);",
+		"}",
+		"",
+		"static inline void fz_write(int line, fz_value path, fz_value data) {",
+		"\tFILE *file = fopen(path.text->data, \"wb\");",
+		"\tif (file == NULL",
+		"\t\t\t|| fwrite(data.text->data, 1, data.text->length, file)",
+		"\t\t\t\t\t!= data.text->length || fclose(file) != 0)",
+		"\t\tfz_fail(line, NULL, \"Unable to write %s\", path.text->data);",
+		"\tfree(path.text);",
+		"\tfree(data.text);",
+		"}",
+		"",
+		"static inline void fz_system(int line, fz_value command, fz_value *status,",
+		"\t\tfz_value *output) {",
+		"\tfflush(stdout);",
+		"\tint result;",
+		"\tif (output != NULL) {",
+		"\t\tFILE *pipe = popen(command.text->data, \"r\");",
+		"\t\tif (pipe == NULL)",
+		"\t\t\tfz_fail(line, NULL, \"Unable to run %s\", command.text->data);",
+		"\t\tfz_readstream(output, pipe);",
+		"\t\tresult = pclose(pipe);",
+		"\t} else {",
+		"\t\tresult = system(command.text->data);",
+		"\t}",
+		"\tif (result == -1)",
+		"\t\tfz_fail(line, NULL, \"Unable to run %s\", command.text->data);",
+		"\tfree(command.text);",
+		"\tif (status != NULL)",
+		"\t\tfz_setnumber(status,",
+		"\t\t\t\tWIFEXITED(result) ?",
+		"\t\t\t\t\t\tWEXITSTATUS(result) : 128 + WTERMSIG(result));",
+		"}",
+		"",
+		"/* The first instruction at or after the line, like interpreter_findline() */",
+		"static inline int fz_jump(int line, const int *lines, int count, double target) {",
+		"\tint low = 0, high = count;",
+		"\twhile (low < high) {",
+		"\t\tint middle = low + (high - low) / 2;",
+		"\t\tif (lines[middle] < (int) target)",
+		"\t\t\tlow = middle + 1;",
+		"\t\telse",
+		"\t\t\thigh = middle;",
+		"\t}",
+		"\tif (low == count)",
+		"\t\tfz_fail(line, \"IndexOutOfBoundsException\",",
+		"\t\t\t\t\"There is nothing to run at line %d!\", (int) target);",
+		"\treturn low;",
+		"}",
+		"",
+		"static inline void fz_overflow(int line, const char *name) {",
+		"\tfz_fail(line, \"StackOverflowException\",",
+		"\t\t\t\"Calling %s goes deeper than %d calls!\", name, FZ_MAX_DEPTH);",
+		"}",
+		"",
+		"/* The builtins of tinyexpr that aren't in math.h */",
+		"static inline double fz_pi(void) {",
+		"\treturn 3.14159265358979323846;",
+		"}",
+		"",
+		"static inline double fz_e(void) {",
+		"\treturn 2.71828182845904523536;",
+		"}",
+		"",
+		"static inline double fz_fac(double a) {",
+		"\tif (a < 0.0)",
+		"\t\treturn NAN;",
+		"\tif (a > UINT_MAX)",
+		"\t\treturn INFINITY;",
+		"\tunsigned int ua = (unsigned int) a;",
+		"\tunsigned long result = 1, i;",
+		"\tfor (i = 1; i <= ua; i++) {",
+		"\t\tif (i > ULONG_MAX / result)",
+		"\t\t\treturn INFINITY;",
+		"\t\tresult *= i;",
+		"\t}",
+		"\treturn (double) result;",
+		"}",
+		"",
+		"static inline double fz_ncr(double n, double r) {",
+		"\tif (n < 0.0 || r < 0.0 || n < r)",
+		"\t\treturn NAN;",
+		"\tif (n > UINT_MAX || r > UINT_MAX)",
+		"\t\treturn INFINITY;",
+		"\tunsigned long un = (unsigned int) n, ur = (unsigned int) r, i;",
+		"\tunsigned long result = 1;",
+		"\tif (ur > un / 2)",
+		"\t\tur = un - ur;",
+		"\tfor (i = 1; i <= ur; i++) {",
+		"\t\tif (result > ULONG_MAX / (un - ur + i))",
+		"\t\t\treturn INFINITY;",
+		"\t\tresult *= un - ur + i;",
+		"\t\tresult /= i;",
+		"\t}",
+		"\treturn result;",
+		"}",
+		"",
+		"static inline double fz_npr(double n, double r) {",
+		"\treturn fz_ncr(n, r) * fz_fac(r);",
+		"}",
+		"",
+		"/*",
+		" * Expressions made of integers are computed exactly in int64 (see intexpr.h). Anything",
+		" * that doesn't fit clears *exact, and the expression is computed in doubles instead.",
+		" */",
+		"static inline long long fz_integer(int *exact, double number) {",
+		"\tif (!(number >= -9223372036854775808.0 && number < 9223372036854775808.0)) {",
+		"\t\t*exact = 0;",
+		"\t\treturn 0;",
+		"\t}",
+		"\tlong long integer = (long long) number;",
+		"\tif ((double) integer != number || (integer == 0 && signbit(number)))",
+		"\t\t*exact = 0; /* not a whole number, or -0 */",
+		"\treturn integer;",
+		"}",
+		"",
+		"static inline long long fz_iadd(int *exact, long long a, long long b) {",
+		"\tlong long result;",
+		"\tif (__builtin_add_overflow(a, b, &result))",
+		"\t\t*exact = 0;",
+		"\treturn result;",
+		"}",
+		"",
+		"static inline long long fz_isub(int *exact, long long a, long long b) {",
+		"\tlong long result;",
+		"\tif (__builtin_sub_overflow(a, b, &result))",
+		"\t\t*exact = 0;",
+		"\treturn result;",
+		"}",
+		"",
+		"static inline long long fz_imul(int *exact, long long a, long long b) {",
+		"\tlong long result;",
+		"\tif (__builtin_mul_overflow(a, b, &result))",
+		"\t\t*exact = 0;",
+		"\treturn result;",
+		"}",
+		"",
+		"/* Functions of the script that nothing calls are translated anyway */",
+		"#define FZ_UNUSED __attribute__((unused))",
+		NULL };
+
+// What the generated program ends with, after the functions of the script
+static const char *emitc_trailer[] = {
+		"static void *fz_run(void *unused) {",
+		"\t(void) unused;",
+		"\tfz_main();",
+		"\treturn NULL;",
+		"}",
+		"",
+		"/* The calls run on a thread with a stack big enough for FZ_MAX_DEPTH of them */",
+		"int main(void) {",
+		"\tpthread_attr_t attributes;",
+		"\tpthread_t thread;",
+		"\tpthread_attr_init(&attributes);",
+		"\tpthread_attr_setstacksize(&attributes, FZ_STACK_SIZE);",
+		"\tif (pthread_create(&thread, &attributes, &fz_run, NULL) == 0)",
+		"\t\tpthread_join(thread, NULL);",
+		"\telse",
+		"\t\tfz_run(NULL);",
+		"\tfflush(stdout);",
+		"\treturn EXIT_SUCCESS;",
+		"}",
+		NULL };
+
+// math.h functions that tinyexpr uses directly (tinyexpr's "log" is log10)
+static const struct {
+	const void *function;
+	const char *name;
+} emitc_mathfunctions[] = { { fabs, "fabs" }, { acos, "acos" },
+		{ asin, "asin" }, { atan, "atan" }, { atan2, "atan2" }, { ceil, "ceil" },
+		{ cos, "cos" }, { cosh, "cosh" }, { exp, "exp" }, { floor, "floor" },
+		{ fmod, "fmod" }, { log, "log" }, { log10, "log10" }, { pow, "pow" },
+		{ sin, "sin" }, { sinh, "sinh" }, { sqrt, "sqrt" }, { tan, "tan" },
+		{ tanh, "tanh" } };
+
+/*
+ * The variables one function can see. Expressions are compiled against every variable bound
+ * to its own double in addresses, so a variable in a te_expr can be told apart by its address.
+ */
+typedef struct {
+	FILE *stream;
+	vm_t *vm;
+	bool top; // the top level code, which only has globals
+	list_t *locals; // names (string_t) of the arguments, then the other locals
+	list_t *globals; // names of everything the top level code sets
+	te_variable *lookup; // locals first, so they hide globals with the same name
+	double *addresses;
+	int lookup_count;
+	int line_num; // of the instruction that is being translated
+	bool failed;
+} emitc_scope_t;
+
+// Static Prototypes
+static void emitc_lines(const char **lines, FILE *stream);
+static void emitc_collect(function_t *funct, int end, list_t *exclude, list_t *names);
+static void emitc_addname(string_t *name, list_t *exclude, list_t *names);
+static bool emitc_contains(string_t *name, list_t *names);
+static void emitc_function(function_t *funct, emitc_scope_t *scope);
+static void emitc_prototype(function_t *funct, FILE *stream);
+static void emitc_instruction(parsed_instruction_t *instr,
+		emitc_scope_t *scope);
+static void emitc_gotoline(parsed_instruction_t *instr, emitc_scope_t *scope);
+static void emitc_call(parsed_instruction_t *instr, bool tail,
+		emitc_scope_t *scope);
+static void emitc_freelocals(emitc_scope_t *scope);
+static void emitc_value(int argIndex, parsed_instruction_t *instr,
+		emitc_scope_t *scope);
+static void emitc_stringvalue(int argIndex, parsed_instruction_t *instr,
+		emitc_scope_t *scope);
+static void emitc_argument(int argIndex, parsed_instruction_t *instr,
+		emitc_scope_t *scope);
+static void emitc_expression(const te_expr *expr, emitc_scope_t *scope);
+static void emitc_integer(const te_expr *expr, emitc_scope_t *scope);
+static void emitc_constant(double value, FILE *stream);
+static int emitc_findvariable(string_t *name, emitc_scope_t *scope);
+static void emitc_variable(int index, emitc_scope_t *scope);
+static void emitc_literal(char *text, int length, FILE *stream);
+static void emitc_fail(emitc_scope_t *scope, exception e, char *message, ...);
+static bool emitc_isstring(string_t *arg);
+static bool emitc_isidentifier(string_t *arg);
+
+bool emitc_program(FILE *stream, char *scriptPath, vm_t *vm) {
+	interpreter_loadall(vm);
+	list_t *functions = vm->function_list;
+	emitc_scope_t scope = { stream, vm, true, list_init(), list_init(), NULL,
+	NULL, 0, -1, false };
+	function_t *top = functions->data[0];
+	emitc_collect(top, top->parsed_instructions->data_length, NULL, scope.globals);
+
+	// The top-level code sets these before anything can jump over them or call a function
+	int end = 0;
+	for (; end < top->parsed_instructions->data_length; end++) {
+		parsed_instruction_t *instr = top->parsed_instructions->data[end];
+		instruction_opcode opcode = instr->opcode;
+		if (opcode == OP_GOTOLINE || opcode == OP_ADD_GOTOLINE
+				|| opcode == OP_ADD_NUMBER_GOTOLINE || opcode == OP_GOTOFUNC
+				|| opcode == OP_TAILFUNC)
+			break;
+	}
+	list_t *early = list_init();
+	emitc_collect(top, end, NULL, early);
+
+	// Only the first function with a name can be called, so the others are left out
+	int mostLocals = scope.globals->data_length;
+	list_t *emitted = list_init();
+	for (int i = 1; i < functions->data_length; i++) {
+		function_t *funct = functions->data[i];
+		if (interpreter_findfunction(funct->name, vm) != funct)
+			continue;
+		if (!emitc_isidentifier(funct->name)) {
+			throw_exception(SYNTAX_EXCEPTION, -1,
+					"The function \"%s\" can't be a C function!",
+					funct->name->text);
+			scope.failed = true;
+			continue;
+		}
+		list_t *names = list_init();
+		emitc_collect(funct, funct->parsed_instructions->data_length, scope.globals, names);
+		if (names->data_length > mostLocals)
+			mostLocals = names->data_length;
+		list_clear(names);
+
+		// The interpreter makes these locals if the function runs before the global exists,
+		// which C can't follow
+		emitc_collect(funct, funct->parsed_instructions->data_length, NULL, names);
+		for (int j = 0; j < names->data_length; j++) {
+			string_t *name = names->data[j];
+			if (emitc_contains(name, scope.globals) && !emitc_contains(name, early)
+					&& !emitc_contains(name, funct->args)) {
+				throw_exception(SYNTAX_EXCEPTION, -1,
+						"%s sets %s, which is only global once the top-level code has set it!",
+						funct->name->text, name->text);
+				scope.failed = true;
+			}
+		}
+		list_free(names);
+		list_add(funct, emitted);
+	}
+
+	// The name of the script goes into a comment, so it can't end the comment
+	fprintf(stream, "/*\n * Translated from ");
+	for (char *letter = scriptPath; *letter != '\0'; letter++)
+		if (!(letter[0] == '*' && letter[1] == '/'))
+			fputc(*letter, stream);
+	fprintf(stream, " by freeze --emit-c\n"
+			" * Build with: cc -O2 -o program this.c -lm -lpthread\n */\n\n");
+	fprintf(stream, "#define FZ_MAX_DEPTH %d\n", vm->max_call_depth);
+	fprintf(stream, "#define FZ_STACK_SIZE ((size_t) (FZ_MAX_DEPTH + 64) * %d)\n\n",
+			EMITC_FRAME_SIZE + EMITC_LOCAL_SIZE * mostLocals);
+	emitc_lines(emitc_runtime, stream);
+
+	fputc('\n', stream);
+	// Only functions count their calls, and an unused variable would be a warning
+	if (emitted->data_length > 0)
+		fprintf(stream, "static int fz_depth = 0;\n\n");
+	for (int i = 0; i < scope.globals->data_length; i++)
+		fprintf(stream, "static fz_value g_%s;\n",
+				((string_t*) scope.globals->data[i])->text);
+	fprintf(stream, "\nstatic void fz_main(void);\n");
+	for (int i = 0; i < emitted->data_length; i++) {
+		emitc_prototype(emitted->data[i], stream);
+		fprintf(stream, " FZ_UNUSED;\n");
+	}
+
+	emitc_function(functions->data[0], &scope);
+	scope.top = false;
+	for (int i = 0; i < emitted->data_length; i++)
+		emitc_function(emitted->data[i], &scope);
+	fputc('\n', stream);
+	emitc_lines(emitc_trailer, stream);
+
+	list_free(emitted);
+	list_free(early);
+	list_free(scope.locals);
+	list_free(scope.globals);
+	return !scope.failed;
+}
+
+static void emitc_lines(const char **lines, FILE *stream) {
+	for (int i = 0; lines[i] != NULL; i++) {
+		fputs(lines[i], stream);
+		fputc('\n', stream);
+	}
+}
+
+/**
+ * Adds the names of the variables the function creates (the arguments, and whatever set,
+ * read or system store into before the instruction end) to names, except for the ones in
+ * exclude.
+ */
+static void emitc_collect(function_t *funct, int end, list_t *exclude, list_t *names) {
+	for (int i = 0; i < funct->args->data_length; i++)
+		emitc_addname(funct->args->data[i], NULL, names);
+
+	list_t *instructions = funct->parsed_instructions;
+	for (int i = 0; i < end; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		list_t *args = instr->args;
+		switch (instr->opcode) {
+		case OP_SET:
+		case OP_SET_EXPRESSION:
+		case OP_SET_NUMBER:
+		case OP_READ:
+			if (args->data_length > 0)
+				emitc_addname(args->data[0], exclude, names);
+			break;
+		case OP_SYSTEM:
+			for (int j = 1; j < args->data_length && j < 3; j++)
+				emitc_addname(args->data[j], exclude, names);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void emitc_addname(string_t *name, list_t *exclude, list_t *names) {
+	if (emitc_isidentifier(name) && !emitc_contains(name, names)
+			&& (exclude == NULL || !emitc_contains(name, exclude)))
+		list_add(name, names);
+}
+
+static bool emitc_contains(string_t *name, list_t *names) {
+	for (int i = 0; i < names->data_length; i++)
+		if (string_equals_s(name, names->data[i]))
+			return true;
+	return false;
+}
+
+static void emitc_function(function_t *funct, emitc_scope_t *scope) {
+	FILE *stream = scope->stream;
+	list_clear(scope->locals);
+	if (!scope->top)
+		emitc_collect(funct, funct->parsed_instructions->data_length, scope->globals,
+				scope->locals);
+	for (int i = 0; i < funct->args->data_length; i++) {
+		if (!emitc_isidentifier(funct->args->data[i])) {
+			throw_exception(SYNTAX_EXCEPTION, -1,
+					"The argument \"%s\" of %s can't be a C variable!",
+					((string_t*) funct->args->data[i])->text, funct->name->text);
+			scope->failed = true;
+		}
+	}
+
+	int count = scope->locals->data_length + scope->globals->data_length;
+	scope->lookup = malloc((count + 1) * sizeof(te_variable));
+	scope->addresses = calloc(count + 1, sizeof(double));
+	scope->lookup_count = count;
+	for (int i = 0; i < count; i++) {
+		int localCount = scope->locals->data_length;
+		string_t *name =
+				i < localCount ?
+						scope->locals->data[i] :
+						scope->globals->data[i - localCount];
+		scope->lookup[i] = (te_variable ) { name->text, &scope->addresses[i],
+						TE_VARIABLE, NULL };
+	}
+
+	// Every instruction needs a label once a gotoline works out where it goes while running
+	list_t *instructions = funct->parsed_instructions;
+	bool dispatch = false;
+	bool *targets = calloc(instructions->data_length + 1, sizeof(bool));
+	for (int i = 0; i < instructions->data_length; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		if (instr->opcode != OP_GOTOLINE)
+			continue;
+		if (instr->jump_index == PARSE_JUMP_UNRESOLVED)
+			dispatch = true;
+		else
+			targets[instr->jump_index] = true;
+	}
+
+	fputc('\n', stream);
+	if (scope->top)
+		fprintf(stream, "static void fz_main(void)");
+	else
+		emitc_prototype(funct, stream);
+	fprintf(stream, " {\n");
+	for (int i = funct->args->data_length; i < scope->locals->data_length;
+			i++)
+		fprintf(stream, "\tfz_value l_%s = FZ_NUMBER(0);\n",
+				((string_t*) scope->locals->data[i])->text);
+	if (dispatch) {
+		fprintf(stream, "\tstatic const int fz_lines[] = {");
+		for (int i = 0; i < instructions->data_length; i++)
+			fprintf(stream, "%s%d", i > 0 ? ", " : " ",
+					((parsed_instruction_t*) instructions->data[i])->line_num);
+		fprintf(stream, " };\n\tint fz_target;\n");
+	}
+	if (!scope->top)
+		fprintf(stream, "\tfz_depth++;\n");
+
+	for (int i = 0; i < instructions->data_length; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		if (dispatch || targets[i])
+			fprintf(stream, "L%d:;\n", i);
+		scope->line_num = instr->line_num;
+		emitc_instruction(instr, scope);
+	}
+
+	if (!scope->top) {
+		fprintf(stream, "fz_return:\n");
+		emitc_freelocals(scope);
+		fprintf(stream, "\tfz_depth--;\n");
+	}
+	if (dispatch) {
+		fprintf(stream, "\treturn;\nfz_dispatch:\n\tswitch (fz_target) {\n");
+		for (int i = 0; i < instructions->data_length; i++)
+			fprintf(stream, "\tcase %d:\n\t\tgoto L%d;\n", i, i);
+		fprintf(stream, "\t}\n");
+	}
+	fprintf(stream, "}\n");
+
+	free(targets);
+	free(scope->lookup);
+	free(scope->addresses);
+	scope->lookup = NULL;
+	scope->addresses = NULL;
+}
+
+static void emitc_prototype(function_t *funct, FILE *stream) {
+	fprintf(stream, "static void f_%s(", funct->name->text);
+	for (int i = 0; i < funct->args->data_length; i++)
+		fprintf(stream, "%sfz_value l_%s", i > 0 ? ", " : "",
+				((string_t*) funct->args->data[i])->text);
+	fprintf(stream, "%s)", funct->args->data_length == 0 ? "void" : "");
+}
+
+static void emitc_instruction(parsed_instruction_t *instr,
+		emitc_scope_t *scope) {
+	FILE *stream = scope->stream;
+	list_t *args = instr->args;
+	int argCount = args->data_length;
+	fprintf(stream, "\t// line %d: %s\n", instr->line_num, instr->name->text);
+
+	switch (instr->opcode) {
+	case OP_SET:
+	case OP_SET_EXPRESSION:
+	case OP_SET_NUMBER: {
+		if (argCount != 2 || !emitc_isidentifier(args->data[0])) {
+			emitc_fail(scope, SYNTAX_EXCEPTION,
+					"Expected a variable name and a value!");
+			return;
+		}
+		string_t *value = args->data[1];
+		int source = emitc_findvariable(value, scope);
+		if (emitc_isstring(value) || source != -1) {
+			fprintf(stream, "\tfz_set(&");
+			emitc_variable(emitc_findvariable(args->data[0], scope), scope);
+			fprintf(stream, ", ");
+			emitc_value(1, instr, scope);
+		} else {
+			fprintf(stream, "\tfz_setnumber(&");
+			emitc_variable(emitc_findvariable(args->data[0], scope), scope);
+			fprintf(stream, ", ");
+			emitc_argument(1, instr, scope);
+		}
+		fprintf(stream, ");\n");
+		break;
+	}
+	case OP_ADD:
+	case OP_ADD_GOTOLINE:
+	case OP_ADD_NUMBER:
+	case OP_ADD_NUMBER_GOTOLINE: {
+		int target = argCount == 2 ? emitc_findvariable(args->data[0], scope) : -1;
+		if (target == -1) {
+			emitc_fail(scope, SYNTAX_EXCEPTION,
+					"Expected a variable that has been set and a value!");
+			return;
+		}
+		string_t *value = args->data[1];
+		bool number = !emitc_isstring(value)
+				&& emitc_findvariable(value, scope) == -1;
+		fprintf(stream, "\tfz_add%s(&", number ? "number" : "value");
+		emitc_variable(target, scope);
+		fprintf(stream, ", ");
+		if (number)
+			emitc_argument(1, instr, scope);
+		else
+			emitc_value(1, instr, scope);
+		fprintf(stream, ");\n");
+		break;
+	}
+	case OP_GOTOLINE:
+		emitc_gotoline(instr, scope);
+		break;
+	case OP_GOTOFUNC:
+	case OP_TAILFUNC:
+		// Calls from the top level code have no call of their own to replace
+		emitc_call(instr, instr->tail_call && !scope->top, scope);
+		break;
+	case OP_PRINT:
+		for (int i = 0; i < argCount; i++) {
+			string_t *arg = args->data[i];
+			int var = emitc_findvariable(arg, scope);
+			if (emitc_isstring(arg)) {
+				fprintf(stream, "\tfz_printtext(");
+				emitc_literal(arg->text + 1, arg->text_length - 2, stream);
+				fprintf(stream, ", %d", arg->text_length - 2);
+			} else if (var != -1) {
+				fprintf(stream, "\tfz_printvalue(&");
+				emitc_variable(var, scope);
+			} else {
+				fprintf(stream, "\tfz_printnumber(");
+				emitc_argument(i, instr, scope);
+			}
+			fprintf(stream, ");\n");
+		}
+		break;
+	case OP_READ:
+		if (argCount != 2 || !emitc_isidentifier(args->data[0])) {
+			emitc_fail(scope, SYNTAX_EXCEPTION,
+					"Expected a variable name and a file!");
+			return;
+		}
+		fprintf(stream, "\tfz_read(%d, &", instr->line_num);
+		emitc_variable(emitc_findvariable(args->data[0], scope), scope);
+		fprintf(stream, ", ");
+		emitc_stringvalue(1, instr, scope);
+		fprintf(stream, ");\n");
+		break;
+	case OP_WRITE:
+		if (argCount < 2) {
+			emitc_fail(scope, SYNTAX_EXCEPTION,
+					"Expected a file and what to write into it!");
+			return;
+		}
+		fprintf(stream, "\t{\n\t\tfz_value fz_data = fz_text(\"\", 0);\n");
+		for (int i = 1; i < argCount; i++) {
+			fprintf(stream, "\t\tfz_appendvalue(&fz_data, ");
+			emitc_value(i, instr, scope);
+			fprintf(stream, ");\n");
+		}
+		fprintf(stream, "\t\tfz_write(%d, ", instr->line_num);
+		emitc_stringvalue(0, instr, scope);
+		fprintf(stream, ", fz_data);\n\t}\n");
+		break;
+	case OP_SYSTEM: {
+		bool validArgs = argCount >= 1 && argCount <= 3;
+		for (int i = 1; validArgs && i < argCount; i++)
+			validArgs = emitc_isidentifier(args->data[i]);
+		if (!validArgs) {
+			emitc_fail(scope, SYNTAX_EXCEPTION,
+					"Expected a command and optional status and output variables!");
+			return;
+		}
+		fprintf(stream, "\tfz_system(%d, ", instr->line_num);
+		emitc_stringvalue(0, instr, scope);
+		for (int i = 1; i < 3; i++) {
+			fprintf(stream, ", ");
+			if (i < argCount) {
+				fputc('&', stream);
+				emitc_variable(emitc_findvariable(args->data[i], scope), scope);
+			} else {
+				fprintf(stream, "NULL");
+			}
+		}
+		fprintf(stream, ");\n");
+		break;
+	}
+	case OP_WAIT:
+		fprintf(stream, "\t; // read, write and system have already finished\n");
+		break;
+	case OP_FUNCTIONEND:
+		fprintf(stream, "\tgoto fz_return;\n");
+		break;
+	case OP_SPAWN:
+		emitc_fail(scope, SYNTAX_EXCEPTION,
+				"spawn can't be translated to C, use system instead!");
+		break;
+	default:
+		emitc_fail(scope, SYNTAX_EXCEPTION, "Unable to run \"%s\"!",
+				instr->name->text);
+		break;
+	}
+}
+
+// gotoline 5 or gotoline 5, i < 10
+static void emitc_gotoline(parsed_instruction_t *instr, emitc_scope_t *scope) {
+	FILE *stream = scope->stream;
+	int argCount = instr->args->data_length;
+	if (argCount == 0 || argCount > 2) {
+		emitc_fail(scope, SYNTAX_EXCEPTION,
+				"Expected a line number and an optional condition!");
+		return;
+	}
+
+	fprintf(stream, "\t");
+	if (argCount == 2) {
+		fprintf(stream, "if (");
+		emitc_argument(1, instr, scope);
+		fprintf(stream, " != 0) ");
+	}
+	if (instr->jump_index != PARSE_JUMP_UNRESOLVED) {
+		fprintf(stream, "goto L%d;\n", instr->jump_index);
+		return;
+	}
+	fprintf(stream, "{\n\t\tfz_target = fz_jump(%d, fz_lines, "
+			"sizeof(fz_lines) / sizeof(fz_lines[0]), ", instr->line_num);
+	emitc_argument(0, instr, scope);
+	fprintf(stream, ");\n\t\tgoto fz_dispatch;\n\t}\n");
+}
+
+// gotofunc greet, "world", 3 or tailfunc greet, "world", 3
+static void emitc_call(parsed_instruction_t *instr, bool tail,
+		emitc_scope_t *scope) {
+	FILE *stream = scope->stream;
+	list_t *args = instr->args;
+	function_t *target =
+			args->data_length > 0 ?
+					interpreter_findfunction(args->data[0], scope->vm) : NULL;
+	if (target == NULL) {
+		emitc_fail(scope, NULL_POINTER_EXCEPTION,
+				"There is no function called \"%s\"!",
+				args->data_length > 0 ? ((string_t*) args->data[0])->text : "");
+		return;
+	}
+	int argCount = args->data_length - 1;
+	if (argCount == 1 && ((string_t*) args->data[1])->text_length == 0)
+		argCount = 0; // "gotofunc f," or a call without any arguments
+	if (argCount != target->args->data_length) {
+		emitc_fail(scope, INDEX_OUT_OF_BOUNDS_EXCEPTION,
+				"%s needs %d argument(s), but got %d!", target->name->text,
+				target->args->data_length, argCount);
+		return;
+	}
+
+	if (!tail) {
+		fprintf(stream, "\tif (fz_depth >= FZ_MAX_DEPTH)\n\t\tfz_overflow(%d, ",
+				instr->line_num);
+		emitc_literal(target->name->text, target->name->text_length, stream);
+		fprintf(stream, ");\n\tf_%s(", target->name->text);
+		for (int i = 0; i < argCount; i++) {
+			if (i > 0)
+				fprintf(stream, ", ");
+			emitc_value(1 + i, instr, scope);
+		}
+		fprintf(stream, ");\n");
+		return;
+	}
+
+	// The arguments can use the locals, so they are worked out before the locals are freed
+	fprintf(stream, "\t{\n");
+	for (int i = 0; i < argCount; i++) {
+		fprintf(stream, "\t\tfz_value fz_arg%d = ", i);
+		emitc_value(1 + i, instr, scope);
+		fprintf(stream, ";\n");
+	}
+	emitc_freelocals(scope);
+	fprintf(stream, "\t\tfz_depth--;\n\t\tf_%s(", target->name->text);
+	for (int i = 0; i < argCount; i++)
+		fprintf(stream, "%sfz_arg%d", i > 0 ? ", " : "", i);
+	fprintf(stream, ");\n\t\treturn;\n\t}\n");
+}
+
+static void emitc_freelocals(emitc_scope_t *scope) {
+	for (int i = 0; i < scope->locals->data_length; i++)
+		fprintf(scope->stream, "\tfz_free(&l_%s);\n",
+				((string_t*) scope->locals->data[i])->text);
+}
+
+/**
+ * Emits an fz_value that belongs to whatever it is passed to: a new string, a copy of a
+ * variable or the result of an expression.
+ */
+static void emitc_value(int argIndex, parsed_instruction_t *instr,
+		emitc_scope_t *scope) {
+	FILE *stream = scope->stream;
+	string_t *arg = instr->args->data[argIndex];
+	int var = emitc_findvariable(arg, scope);
+	if (emitc_isstring(arg)) {
+		fprintf(stream, "fz_text(");
+		emitc_literal(arg->text + 1, arg->text_length - 2, stream);
+		fprintf(stream, ", %d)", arg->text_length - 2);
+	} else if (var != -1) {
+		fprintf(stream, "fz_copy(&");
+		emitc_variable(var, scope);
+		fputc(')', stream);
+	} else {
+		fprintf(stream, "FZ_NUMBER(");
+		emitc_argument(argIndex, instr, scope);
+		fputc(')', stream);
+	}
+}
+
+// The same, for an argument that has to be a string when it runs
+static void emitc_stringvalue(int argIndex, parsed_instruction_t *instr,
+		emitc_scope_t *scope) {
+	string_t *arg = instr->args->data[argIndex];
+	fprintf(scope->stream, "fz_needstring(%d, ", instr->line_num);
+	emitc_value(argIndex, instr, scope);
+	fprintf(scope->stream, ", ");
+	emitc_literal(arg->text, arg->text_length, scope->stream);
+	fputc(')', scope->stream);
+}
+
+// Emits the argument as a C expression of type double
+static void emitc_argument(int argIndex, parsed_instruction_t *instr,
+		emitc_scope_t *scope) {
+	string_t *arg = instr->args->data[argIndex];
+	int error;
+	te_expr *expr = te_compile(arg->text, scope->lookup, scope->lookup_count,
+			&error);
+	if (expr == NULL) {
+		emitc_fail(scope, SYNTAX_EXCEPTION,
+				"Unable to understand \"%s\" near character %d!", arg->text,
+				error);
+		fprintf(scope->stream, "NAN");
+		return;
+	}
+	if (argIndex < 32 && intexpr_check(expr)) {
+		// The same int64 path as the interpreter, falling back to doubles the same way
+		fprintf(scope->stream, "({ int fz_exact = 1; long long fz_result = ");
+		emitc_integer(expr, scope);
+		fprintf(scope->stream, "; fz_exact ? (double) fz_result : ");
+		emitc_expression(expr, scope);
+		fprintf(scope->stream, "; })");
+	} else {
+		emitc_expression(expr, scope);
+	}
+	te_free(expr);
+}
+
+static void emitc_expression(const te_expr *expr, emitc_scope_t *scope) {
+	FILE *stream = scope->stream;
+	int type = EMITC_TYPE_MASK(expr->type);
+	if (type == TE_CONSTANT) {
+		emitc_constant(expr->value, stream);
+		return;
+	} else if (type == TE_VARIABLE) {
+		emitc_variable(expr->bound - scope->addresses, scope);
+		fprintf(stream, ".number");
+		return;
+	} else if (type < TE_FUNCTION0 || type > TE_FUNCTION7) {
+		emitc_fail(scope, SYNTAX_EXCEPTION,
+				"An expression can't be translated to C!");
+		fprintf(stream, "NAN");
+		return;
+	}
+
+	const te_expr *left = expr->parameters[0], *right = expr->parameters[1];
+	char *infix = NULL;
+	switch (te_function_operator(expr->function)) {
+	case TE_OPERATOR_ADD:
+		infix = " + ";
+		break;
+	case TE_OPERATOR_SUB:
+		infix = " - ";
+		break;
+	case TE_OPERATOR_MUL:
+		infix = " * ";
+		break;
+	case TE_OPERATOR_DIVIDE:
+		infix = " / ";
+		break;
+	case TE_OPERATOR_NEGATE:
+		fprintf(stream, "(-");
+		emitc_expression(left, scope);
+		fputc(')', stream);
+		return;
+	case TE_OPERATOR_COMMA:
+		fprintf(stream, "((void) ");
+		emitc_expression(left, scope);
+		fprintf(stream, ", ");
+		emitc_expression(right, scope);
+		fputc(')', stream);
+		return;
+	// Comparisons are 1 or 0, as a double
+	case TE_OPERATOR_GREATER:
+		infix = " > ";
+		break;
+	case TE_OPERATOR_GREATER_EQ:
+		infix = " >= ";
+		break;
+	case TE_OPERATOR_LOWER:
+		infix = " < ";
+		break;
+	case TE_OPERATOR_LOWER_EQ:
+		infix = " <= ";
+		break;
+	case TE_OPERATOR_EQUAL:
+		infix = " == ";
+		break;
+	case TE_OPERATOR_NOT_EQUAL:
+		infix = " != ";
+		break;
+	case TE_OPERATOR_NONE:
+		break;
+	}
+	if (infix != NULL) {
+		bool comparison = te_function_operator(expr->function)
+				>= TE_OPERATOR_GREATER;
+		fprintf(stream, comparison ? "(double) (" : "(");
+		emitc_expression(left, scope);
+		fputs(infix, stream);
+		emitc_expression(right, scope);
+		fputc(')', stream);
+		return;
+	}
+
+	// Everything else is a call to math.h or to a copy of the builtin in the runtime
+	const char *name = NULL;
+	int count = sizeof(emitc_mathfunctions) / sizeof(emitc_mathfunctions[0]);
+	for (int i = 0; i < count && name == NULL; i++)
+		if (emitc_mathfunctions[i].function == expr->function)
+			name = emitc_mathfunctions[i].name;
+	if (name != NULL) {
+		fprintf(stream, "%s(", name);
+	} else if ((name = te_function_name(expr->function)) != NULL) {
+		fprintf(stream, "fz_%s(", name);
+	} else {
+		emitc_fail(scope, SYNTAX_EXCEPTION,
+				"A function in an expression can't be translated to C!");
+		fprintf(stream, "NAN");
+		return;
+	}
+	for (int i = 0; i < EMITC_ARITY(expr->type); i++) {
+		if (i > 0)
+			fprintf(stream, ", ");
+		emitc_expression(expr->parameters[i], scope);
+	}
+	fputc(')', stream);
+}
+
+// Emits an expression that intexpr_check() accepted as a C expression of type long long
+static void emitc_integer(const te_expr *expr, emitc_scope_t *scope) {
+	FILE *stream = scope->stream;
+	long long integer;
+	switch (EMITC_TYPE_MASK(expr->type)) {
+	case TE_CONSTANT:
+		intexpr_integer(expr->value, &integer);
+		if (integer == LLONG_MIN)
+			fprintf(stream, "(-9223372036854775807LL - 1)");
+		else
+			fprintf(stream, integer < 0 ? "(%lldLL)" : "%lldLL", integer);
+		return;
+	case TE_VARIABLE:
+		fprintf(stream, "fz_integer(&fz_exact, ");
+		emitc_variable(expr->bound - scope->addresses, scope);
+		fprintf(stream, ".number)");
+		return;
+	case TE_FUNCTION1: // negation
+		fprintf(stream, "fz_isub(&fz_exact, 0, ");
+		emitc_integer(expr->parameters[0], scope);
+		fputc(')', stream);
+		return;
+	default:
+		break;
+	}
+
+	const te_expr *left = expr->parameters[0], *right = expr->parameters[1];
+	char *call = NULL, *infix = NULL;
+	switch (te_function_operator(expr->function)) {
+	case TE_OPERATOR_ADD:
+		call = "fz_iadd";
+		break;
+	case TE_OPERATOR_SUB:
+		call = "fz_isub";
+		break;
+	case TE_OPERATOR_MUL:
+		call = "fz_imul";
+		break;
+	case TE_OPERATOR_COMMA:
+		fprintf(stream, "((void) ");
+		emitc_integer(left, scope);
+		fprintf(stream, ", ");
+		emitc_integer(right, scope);
+		fputc(')', stream);
+		return;
+	case TE_OPERATOR_GREATER:
+		infix = " > ";
+		break;
+	case TE_OPERATOR_GREATER_EQ:
+		infix = " >= ";
+		break;
+	case TE_OPERATOR_LOWER:
+		infix = " < ";
+		break;
+	case TE_OPERATOR_LOWER_EQ:
+		infix = " <= ";
+		break;
+	case TE_OPERATOR_EQUAL:
+		infix = " == ";
+		break;
+	case TE_OPERATOR_NOT_EQUAL:
+		infix = " != ";
+		break;
+	default:
+		break;
+	}
+	if (call != NULL) {
+		fprintf(stream, "%s(&fz_exact, ", call);
+		emitc_integer(left, scope);
+		fprintf(stream, ", ");
+		emitc_integer(right, scope);
+		fputc(')', stream);
+	} else {
+		fprintf(stream, "(long long) (");
+		emitc_integer(left, scope);
+		fputs(infix, stream);
+		emitc_integer(right, scope);
+		fputc(')', stream);
+	}
+}
+
+// Enough digits that the constant is exactly the same double
+static void emitc_constant(double value, FILE *stream) {
+	if (isnan(value)) {
+		fprintf(stream, "NAN");
+	} else if (isinf(value)) {
+		fprintf(stream, value > 0 ? "INFINITY" : "(-INFINITY)");
+	} else {
+		char text[32];
+		snprintf(text, sizeof(text), "%.17g", value);
+		bool whole = strpbrk(text, ".e") == NULL;
+		fprintf(stream, signbit(value) ? "(%s%s)" : "%s%s", text,
+				whole ? ".0" : "");
+	}
+}
+
+static int emitc_findvariable(string_t *name, emitc_scope_t *scope) {
+	for (int i = 0; i < scope->lookup_count; i++)
+		if (string_equals(name, (char*) scope->lookup[i].name))
+			return i;
+	return -1;
+}
+
+static void emitc_variable(int index, emitc_scope_t *scope) {
+	fprintf(scope->stream,
+			index < scope->locals->data_length ? "l_%s" : "g_%s",
+			scope->lookup[index].name);
+}
+
+// A C string with the same characters (anything unusual is escaped in octal)
+static void emitc_literal(char *text, int length, FILE *stream) {
+	fputc('"', stream);
+	for (int i = 0; i < length; i++) {
+		unsigned char letter = text[i];
+		if (letter == '"' || letter == '\\')
+			fprintf(stream, "\\%c", letter);
+		else if (letter == '?' || !isprint(letter))
+			fprintf(stream, "\\%03o", letter); // ? could be part of a trigraph
+		else
+			fputc(letter, stream);
+	}
+	fputc('"', stream);
+}
+
+static void emitc_fail(emitc_scope_t *scope, exception e, char *message, ...) {
+	char text[256];
+	va_list args;
+	va_start(args, message);
+	vsnprintf(text, sizeof(text), message, args);
+	va_end(args);
+	throw_exception(e, scope->line_num, "%s", text);
+	scope->failed = true;
+}
+
+static bool emitc_isstring(string_t *arg) {
+	return arg->text_length >= 2 && (arg->text[0] == '"' || arg->text[0] == '\'')
+			&& arg->text[arg->text_length - 1] == arg->text[0];
+}
+
+// The same names that tinyexpr understands (and that are fine in C after a prefix)
+static bool emitc_isidentifier(string_t *arg) {
+	if (arg->text_length == 0 || !isalpha((unsigned char ) arg->text[0]))
+		return false;
+	for (int i = 1; i < arg->text_length; i++)
+		if (!isalnum((unsigned char ) arg->text[i]) && arg->text[i] != '_')
+			return false;
+	return true;
+}
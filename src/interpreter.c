@@ -30,9 +30,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
 
 #include "../include/interpreter.h"
 #include "../include/stringobj.h"
+#include "../include/memstats.h"
+#include "../include/threadpool.h"
+#include "../include/intexpr.h"
+#include "../include/source.h"
+#include "../include/throwable.h"
 
 /*
  * What needs to be defined in order to bootstrap:
@@ -61,9 +71,132 @@
  * end
  */
 
+/*
+ * Preprocessing:
+ * - the source is skimmed first (see source.h), and only the top level code is parsed right
+ * away. A function gets its name and arguments from its header, and the rest of it is parsed
+ * the first time it is called (see interpreter_loadbody())
+ *
+ * Preprocessing of big files with a lot of top level code (or nested functions):
+ * - the file is cut into chunks that always start at the beginning of a line
+ * - every chunk is parsed on the thread pool into its own list of instructions (line numbers are
+ * relative to the chunk, since a chunk doesn't know how many lines came before it)
+ * - afterwards, the chunks are stitched together in order, which is the only place where
+ * function/functionend nesting is looked at
+ */
+
+// Files smaller than two chunks are not worth starting threads for
+#define PREPROCESS_MIN_CHUNK_SIZE (1 << 20)
+// More chunks than threads, so one slow chunk doesn't leave the other threads waiting
+#define PREPROCESS_CHUNKS_PER_THREAD 4
+
+typedef struct {
+	char *start, *end; // [start, end)
+
+	// Copied from the vm_t so that the worker threads never touch the vm
+	char set_delimiter, arg_delimiter, comment_delimiter;
+
+	list_t *instructions; // list of parsed_instruction_t
+	int line_count;
+} preprocess_chunk_t;
+
+// How much of the stream interpreter_stream() reads at once
+#define STREAM_BUFFER_SIZE 65536
+
+// What interpreter_stream() keeps from one line to the next
+typedef struct {
+	preprocess_chunk_t chunk; // only counts the lines
+	list_t *function_stack;
+	int function_count; // the functions from this index on are still being read
+	int skip_line; // a gotoline at the top level skips what comes before this line
+	bool skipping;
+} stream_state_t;
+
 // Static Prototypes
-static int readLine(string_t *str, FILE *stream);
-static list_t* parse_split_offquotes(string_t *delimiter, string_t *line);
+static void preprocess_parallel(char *start, char *end, list_t *functionStack,
+		vm_t *vm);
+static void preprocess_chunkinit(preprocess_chunk_t *chunk, char *start,
+		char *end, vm_t *vm);
+static void preprocess_parsechunk(void *chunk);
+static void preprocess_text(char *start, char *end, int lineOffset,
+		list_t *functionStack, vm_t *vm);
+static void preprocess_line(char *text, int length,
+		preprocess_chunk_t *chunk);
+static void preprocess_stitch(list_t *instructions, int lineOffset,
+		list_t *functionStack, vm_t *vm);
+static void preprocess_header(source_span_t *span, list_t *functionStack,
+		vm_t *vm);
+static void preprocess_body(function_t *funct, vm_t *vm);
+static void preprocess_resolvejumps(function_t *funct, vm_t *vm);
+static void preprocess_movefunction(function_t *funct, int lineOffset,
+		vm_t *vm);
+static void preprocess_optimizefunction(function_t *funct, int firstIndex,
+		vm_t *vm);
+static instruction_opcode preprocess_opcode(string_t *name, vm_t *vm);
+static bool preprocess_returnsafter(int index, function_t *funct, vm_t *vm);
+static void preprocess_infertypes(vm_t *vm);
+static void preprocess_inferfunction(function_t *funct, vm_t *vm);
+static bool preprocess_markstrings(function_t *funct, vm_t *vm);
+static bool preprocess_specialize(function_t *funct, vm_t *vm);
+static bool preprocess_markstring(string_t *name, vm_t *vm);
+static bool preprocess_maybestring(string_t *arg, vm_t *vm);
+static void interpreter_guard(te_variable *var, vm_t *vm);
+static void interpreter_deoptimize(vm_t *vm);
+static void interpreter_streamline(char *text, int length,
+		stream_state_t *state, vm_t *vm);
+static void interpreter_streamjump(parsed_instruction_t *instr,
+		stream_state_t *state, vm_t *vm);
+static void interpreter_streamfree(function_t *topLevel);
+static bool interpreter_loadbody(function_t *funct, vm_t *vm);
+static int interpreter_findline(int line, function_t *funct);
+static void interpreter_halt(vm_t *vm);
+static list_t* interpreter_variables(function_t *funct, vm_t *vm);
+static te_variable* interpreter_findvariable(string_t *name,
+		function_t *funct, vm_t *vm);
+static double interpreter_evaluate(int argIndex, parsed_instruction_t *instr,
+		function_t *funct, vm_t *vm);
+static void interpreter_jit(parsed_instruction_t *instr, vm_t *vm);
+static inline void interpreter_dispatch(int lineNum, function_t *funct,
+		bool instrumented, bool sampled, vm_t *vm);
+static bool interpreter_assign(value_t *dest, int argIndex,
+		parsed_instruction_t *instr, function_t *funct, vm_t *vm);
+static void interpreter_set(parsed_instruction_t *instr, function_t *funct,
+		vm_t *vm);
+static void interpreter_add(parsed_instruction_t *instr, function_t *funct,
+		bool numeric, vm_t *vm);
+static void interpreter_setexpression(parsed_instruction_t *instr,
+		function_t *funct, bool numeric, vm_t *vm);
+static int interpreter_gotoline(int index, parsed_instruction_t *instr,
+		function_t *funct, vm_t *vm);
+static function_t* interpreter_gotofunc(parsed_instruction_t *instr,
+		vm_t *vm);
+static bool interpreter_enter(function_t *target, int firstArg,
+		parsed_instruction_t *instr, function_t *caller, int returnIndex,
+		bool tail, vm_t *vm);
+static call_frame_t interpreter_leave(vm_t *vm);
+static void interpreter_tracecall(call_frame_t *frame, trace_t *trace);
+static bool interpreter_reserveslots(int count, vm_t *vm);
+static void interpreter_startio(vm_t *vm);
+static void interpreter_read(parsed_instruction_t *instr, function_t *funct,
+		vm_t *vm);
+static void interpreter_write(parsed_instruction_t *instr, function_t *funct,
+		vm_t *vm);
+static void interpreter_system(bool background, parsed_instruction_t *instr,
+		function_t *funct, vm_t *vm);
+static void interpreter_collect(process_t *proc, vm_t *vm);
+static void interpreter_wait(vm_t *vm);
+static te_variable* interpreter_target(int argIndex,
+		parsed_instruction_t *instr, function_t *funct, vm_t *vm);
+static string_t* interpreter_string(int argIndex, parsed_instruction_t *instr,
+		function_t *funct, vm_t *vm);
+static string_t* interpreter_concat(int firstArg, parsed_instruction_t *instr,
+		function_t *funct, vm_t *vm);
+static te_variable* variable_find(string_t *name, list_t *variables);
+static void variable_reset(void *var);
+static string_t* parse_filteronlywords(string_t *str);
+static list_t* parse_split_offquotes(char delimiter, string_t *line);
+static bool parse_isstring(string_t *arg);
+static bool parse_isidentifier(string_t *arg);
 
 vm_t* vm_init() {
 	vm_t *vm = malloc(sizeof(vm_t));
@@ -71,12 +204,14 @@ vm_t* vm_init() {
 	// Extremely Core Components of the interpreter
 	vm->set_delimiter = ' ';
 	vm->arg_delimiter = ',';
+	vm->comment_delimiter = '#';
 
 	vm->var_declare = string_copyvalueof("set");
 	vm->var_add = string_copyvalueof("add");
 
 	vm->goto_line = string_copyvalueof("gotoline");
 	vm->goto_function = string_copyvalueof("gotofunc");
+	vm->tail_function = string_copyvalueof("tailfunc");
 
 	vm->function_declare = string_copyvalueof("function");
 	vm->function_end = string_copyvalueof("functionend"); // TODO: This needs to be changed
@@ -85,12 +220,53 @@ vm_t* vm_init() {
 	vm->read_function = string_copyvalueof("read");
 	vm->write_function = string_copyvalueof("write");
 	vm->system_function = string_copyvalueof("system"); // can call windows/linux/etc commands with this
+	vm->spawn_function = string_copyvalueof("spawn");
+	vm->wait_function = string_copyvalueof("wait");
 
 	// Lists
 	vm->global_variables = list_init();
 	vm->function_list = list_init();
+	vm->function_map = map_init();
+	vm->string_names = NULL;
+	vm->source = NULL;
+	vm->function_generation = 0;
+	// Everything outside of a function declaration goes into the first function
+	list_add(function_init(string_copyvalueof("<main>"), list_init()),
+			vm->function_list);
 	vm->currentFunction = 0;
 
+	// Preprocessing
+	vm->preprocess_threads = 0;
+
+	// Execution
+	vm->output = output_init(STDOUT_FILENO,
+			output_defaultpolicy(STDOUT_FILENO));
+	vm->running = false;
+	vm->error_count = 0;
+
+	// Call stack
+	vm->frames = malloc(CALL_STACK_INITIAL_FRAMES * sizeof(call_frame_t));
+	vm->frame_count = 0;
+	vm->frames_allocated = CALL_STACK_INITIAL_FRAMES;
+	vm->slots = malloc(CALL_STACK_INITIAL_SLOTS * sizeof(call_slot_t));
+	vm->slot_count = 0;
+	vm->slots_allocated = CALL_STACK_INITIAL_SLOTS;
+	vm->max_call_depth = CALL_STACK_DEFAULT_DEPTH;
+	vm->count_instructions = false;
+	vm->profile = NULL;
+	vm->sampler = NULL;
+	vm->trace = NULL;
+	vm->jit = NULL;
+	vm->jit_enabled = true;
+
+	// File I/O
+	vm->io = NULL;
+	vm->io_uring = true;
+
+	// Child processes
+	vm->children = list_init();
+	vm->max_children = threadpool_cpucount();
+
 	return vm;
 }
 
@@ -100,151 +276,1908 @@ void vm_free(vm_t *vm) {
 
 	string_free(vm->goto_line);
 	string_free(vm->goto_function);
+	string_free(vm->tail_function);
 
 	string_free(vm->function_declare);
+	string_free(vm->function_end);
 
 	string_free(vm->print_function);
 	string_free(vm->read_function);
 	string_free(vm->write_function);
 	string_free(vm->system_function);
+	string_free(vm->spawn_function);
+	string_free(vm->wait_function);
+
+	if (vm->io != NULL)
+		asyncio_free(vm->io);
+	list_complete_free(&process_free, vm->children);
+	if (vm->jit != NULL)
+		jit_free(vm->jit);
+	if (vm->profile != NULL)
+		profile_free(vm->profile);
+	if (vm->sampler != NULL)
+		sampler_free(vm->sampler);
+	if (vm->trace != NULL)
+		trace_free(vm->trace);
+	output_free(vm->output);
+	free(vm->frames); // a finished run leaves the call stack empty
+	free(vm->slots);
 
 	// Freeing Lists
-	list_complete_free(&te_free, vm->global_variables);
+	list_complete_free(&variable_free, vm->global_variables);
 	list_complete_free(&function_free, vm->function_list);
+	map_free(vm->function_map);
+	if (vm->string_names != NULL)
+		map_free(vm->string_names);
+	if (vm->source != NULL)
+		source_free(vm->source);
 
 	free(vm);
 }
 
+void vm_reset(vm_t *vm) {
+	// The variables themselves stay, since compiled expressions point to them
+	for (int i = 0; i < vm->global_variables->data_length; i++)
+		variable_reset(vm->global_variables->data[i]);
+	for (int i = 0; i < vm->function_list->data_length; i++) {
+		list_t *locals =
+				((function_t*) vm->function_list->data[i])->local_variables;
+		for (int j = 0; j < locals->data_length; j++)
+			variable_reset(locals->data[j]);
+	}
+
+	vm->running = false;
+	vm->error_count = 0;
+}
+
 void interpreter_ignition(FILE *stream, vm_t *virt) {
 	interpreter_preprocessfile(stream, virt);
+	if (virt->error_count > 0)
+		return; // don't run half of a program
+
+	interpreter_run(virt);
+}
+
+void interpreter_run(vm_t *vm) {
+	long long started = vm->trace != NULL ? trace_now() : 0;
+	vm->running = true;
+	interpreter_execute(0, vm->function_list->data[0], vm);
+	interpreter_wait(vm); // a program is done when its files and commands are
+	vm->running = false;
+	output_flush(vm->output);
+	if (vm->trace != NULL)
+		trace_span(TRACE_PHASE, "run", NULL, -1, started, vm->trace);
+}
+
+void interpreter_stream(FILE *stream, vm_t *vm) {
+	long long started = vm->trace != NULL ? trace_now() : 0;
+	function_t *topLevel = vm->function_list->data[0];
+	stream_state_t state;
+	preprocess_chunkinit(&state.chunk, NULL, NULL, vm);
+	list_free(state.chunk.instructions); // every line gets a list of its own
+	state.function_stack = list_init();
+	list_add(topLevel, state.function_stack);
+	state.function_count = vm->function_list->data_length;
+	state.skip_line = 0;
+	state.skipping = false;
+
+	string_t *partial = string_init(); // a line that is cut in two by the end of the buffer
+	char *buffer = malloc(STREAM_BUFFER_SIZE);
+	int fd = fileno(stream);
+	vm->running = true;
+	while (vm->running) {
+		// Reading can wait for a while, so the output goes out first. After the flush, print
+		// doesn't point into the instructions anymore, and the ones that ran can go.
+		output_flush(vm->output);
+		interpreter_streamfree(topLevel);
+
+		ssize_t readCount = read(fd, buffer, STREAM_BUFFER_SIZE);
+		if (readCount == -1 && errno == EINTR)
+			continue;
+		if (readCount == -1) {
+			throw_exception(ERRNO_EXCEPTION, -1, "Unable to read the script");
+			interpreter_halt(vm);
+			break;
+		}
+		if (readCount == 0) {
+			if (partial->text_length > 0)
+				interpreter_streamline(partial->text, partial->text_length,
+						&state, vm);
+			break;
+		}
+
+		char *current = buffer, *end = buffer + readCount;
+		while (vm->running && current < end) {
+			char *newline = memchr(current, '\n', end - current);
+			if (newline == NULL) {
+				string_appendn(partial, current, end - current);
+				break;
+			}
+			if (partial->text_length > 0) {
+				string_appendn(partial, current, newline - current);
+				interpreter_streamline(partial->text, partial->text_length,
+						&state, vm);
+				string_reset(partial);
+			} else {
+				interpreter_streamline(current, newline - current, &state, vm);
+			}
+			current = newline + 1;
+		}
+	}
+	if (vm->running && state.skipping) {
+		throw_exception(INDEX_OUT_OF_BOUNDS_EXCEPTION, -1,
+				"There is nothing to run at line %d!", state.skip_line);
+		interpreter_halt(vm);
+	}
+
+	interpreter_wait(vm);
+	vm->running = false;
+	output_flush(vm->output);
+	interpreter_streamfree(topLevel);
+	free(buffer);
+	string_free(partial);
+	list_free(state.function_stack);
+	if (vm->trace != NULL)
+		trace_span(TRACE_PHASE, "stream", NULL, -1, started, vm->trace);
+}
+
+void interpreter_call(parsed_instruction_t *call, vm_t *vm) {
+	function_t *target = interpreter_findfunction(call->name, vm);
+	if (target == NULL) {
+		throw_exception(NULL_POINTER_EXCEPTION, call->line_num,
+				"There is no function called \"%s\"!", call->name->text);
+		vm->error_count++;
+		return;
+	}
+
+	vm->running = true;
+	if (interpreter_enter(target, 0, call, vm->function_list->data[0],
+	CALL_RETURN_EXTERNAL, false, vm))
+		interpreter_execute(0, target, vm);
+	interpreter_wait(vm);
+	vm->running = false;
+	output_flush(vm->output);
+}
+
+function_t* interpreter_findfunction(string_t *name, vm_t *vm) {
+	return map_get(name, vm->function_map);
+}
+
+void interpreter_indexfunctions(vm_t *vm) {
+	map_clear(vm->function_map);
+	// The first function is the top level code, which can't be called
+	for (int i = 1; i < vm->function_list->data_length; i++) {
+		function_t *funct = vm->function_list->data[i];
+		map_put(funct->name, funct, vm->function_map);
+	}
+	vm->function_generation++;
+}
+
+bool interpreter_reload(source_map_t *source, vm_t *vm) {
+	long long started = vm->trace != NULL ? trace_now() : 0;
+	source_map_t *previous = vm->source;
+	list_t *oldList = vm->function_list;
+	function_t *oldMain = oldList->data[0];
+	int errorCount = vm->error_count;
+
+	// Functions are only loaded one by one if the skim found all of them, and big files with
+	// a lot of top level code are better off parsed in parallel
+	bool bySpan = !source->nested
+			&& source->main_length < 2 * PREPROCESS_MIN_CHUNK_SIZE;
+	bool incremental = bySpan && previous != NULL && !previous->nested;
+	list_t *newList = list_init();
+	map_t *kept = map_init(); // the old functions that didn't change, by name
+	vm->function_list = newList; // where preprocess_stitch() adds what it parses
+
+	function_t *topLevel = oldMain;
+	if (!incremental || !source_samemain(source, previous))
+		topLevel = function_init(string_copyvalueof("<main>"), list_init());
+	list_add(topLevel, newList);
+	list_t *functionStack = list_init();
+	list_add(topLevel, functionStack);
+
+	if (!bySpan && source->length >= 2 * PREPROCESS_MIN_CHUNK_SIZE) {
+		preprocess_parallel(source->text, source->text + source->length,
+				functionStack, vm);
+	} else if (!bySpan) {
+		preprocess_text(source->text, source->text + source->length, 0,
+				functionStack, vm);
+	} else {
+		// A header without a name leaves the rest of its function outside of it
+		function_t *outside = function_init(string_copyvalueof("<outside>"),
+				list_init());
+		list_t *spanStack = list_init();
+		list_add(outside, spanStack);
+
+		// The top level code is whatever is around the functions
+		char *segment = source->text;
+		int lineOffset = 0;
+		for (int i = 0; i <= source->spans->data_length; i++) {
+			source_span_t *span =
+					i < source->spans->data_length ?
+							source->spans->data[i] : NULL;
+			if (topLevel != oldMain)
+				preprocess_text(segment,
+						span != NULL ?
+								span->start : source->text + source->length,
+						lineOffset, functionStack, vm);
+			if (span == NULL)
+				break;
+			segment = span->end;
+			lineOffset = span->last_line;
+
+			source_span_t *oldSpan =
+					incremental ? source_findspan(span->name, previous) : NULL;
+			function_t *funct = interpreter_findfunction(span->name, vm);
+			if (oldSpan != NULL && funct != NULL
+					&& source_samespan(span, oldSpan) && map_put(funct->name, funct, kept)) {
+				list_add(funct, newList);
+			} else {
+				preprocess_header(span, spanStack, vm);
+			}
+		}
+		list_free(spanStack);
+		function_free(outside);
+	}
+	list_free(functionStack);
+
+	if (vm->error_count > errorCount) {
+		for (int i = 0; i < newList->data_length; i++) {
+			function_t *funct = newList->data[i];
+			if (funct != oldMain && map_get(funct->name, kept) != funct)
+				function_free(funct);
+		}
+		list_free(newList);
+		map_free(kept);
+		vm->function_list = oldList;
+		source_free(source);
+		return false;
+	}
+
+	// Every span is now one function, and the ones that were kept may have moved. Until now,
+	// a failed reload could still have left them with the old source.
+	for (int i = 0; incremental && i < source->spans->data_length; i++) {
+		source_span_t *span = source->spans->data[i];
+		function_t *funct = newList->data[i + 1];
+		if (map_get(funct->name, kept) != funct)
+			continue;
+		if (funct->body != NULL)
+			funct->body = span; // the old source is about to be freed
+		int lineOffset = span->first_line
+				- source_findspan(span->name, previous)->first_line;
+		if (lineOffset != 0)
+			preprocess_movefunction(funct, lineOffset, vm);
+	}
+
+	for (int i = 0; i < oldList->data_length; i++) {
+		function_t *funct = oldList->data[i];
+		if (i == 0 ? funct != topLevel : map_get(funct->name, kept) != funct)
+			function_free(funct);
+	}
+	list_free(oldList);
+
+	for (int i = 0; i < newList->data_length; i++) {
+		function_t *funct = newList->data[i];
+		if (i == 0 ? funct != oldMain : map_get(funct->name, kept) != funct) {
+			preprocess_resolvejumps(funct, vm);
+			preprocess_optimizefunction(funct, 0, vm);
+		}
+	}
+	map_free(kept);
+	interpreter_indexfunctions(vm);
+
+	// Whether a name can hold a string depends on the whole program
+	if (vm->string_names != NULL)
+		interpreter_deoptimize(vm);
+	preprocess_infertypes(vm);
+
+	if (previous != NULL)
+		source_free(previous);
+	vm->source = source;
+	if (vm->trace != NULL)
+		trace_span(TRACE_PHASE, previous != NULL ? "reload" : "preprocess",
+		NULL, -1, started, vm->trace);
+	return true;
 }
 
 void interpreter_preprocessfile(FILE *stream, vm_t *vm) {
+	source_map_t *source = source_read(stream, vm);
+	if (source == NULL) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to read the script");
+		vm->error_count++;
+		return;
+	}
+	interpreter_reload(source, vm);
+}
+
+void interpreter_loadall(vm_t *vm) {
+	bool loaded = false;
+	for (int i = 0; i < vm->function_list->data_length; i++) {
+		function_t *funct = vm->function_list->data[i];
+		if (funct->body != NULL) {
+			preprocess_body(funct, vm);
+			loaded = true;
+		}
+	}
+	if (loaded && vm->string_names != NULL)
+		interpreter_deoptimize(vm);
+	if (loaded)
+		preprocess_infertypes(vm);
+}
+
+/**
+ * Parses the text in chunks on the thread pool. Every chunk starts at the beginning of a line,
+ * and the chunks are stitched together in order afterwards.
+ */
+static void preprocess_parallel(char *start, char *end, list_t *functionStack,
+		vm_t *vm) {
+	int threadCount =
+			vm->preprocess_threads > 0 ?
+					vm->preprocess_threads : threadpool_cpucount();
+	long chunkCount = (end - start) / PREPROCESS_MIN_CHUNK_SIZE;
+	if (chunkCount > threadCount * PREPROCESS_CHUNKS_PER_THREAD)
+		chunkCount = threadCount * PREPROCESS_CHUNKS_PER_THREAD;
+	long chunkSize = (end - start) / chunkCount;
+
+	// Every chunk boundary is moved forward to the start of the next line
+	preprocess_chunk_t *chunks = malloc(chunkCount * sizeof(preprocess_chunk_t));
+	int actualCount = 0;
+	char *chunkStart = start;
+	for (long i = 0; i < chunkCount && chunkStart < end; i++) {
+		char *chunkEnd = end;
+		if (i < chunkCount - 1 && chunkStart + chunkSize < end) {
+			char *newline = memchr(chunkStart + chunkSize, '\n',
+					end - (chunkStart + chunkSize));
+			if (newline != NULL)
+				chunkEnd = newline + 1;
+		}
+		preprocess_chunkinit(&chunks[actualCount++], chunkStart, chunkEnd, vm);
+		chunkStart = chunkEnd;
+	}
+
+	threadpool_t *pool = threadpool_init(threadCount);
+	for (int i = 0; i < actualCount; i++)
+		threadpool_submit(&preprocess_parsechunk, &chunks[i], pool);
+	threadpool_free(pool);
+
+	// The cheap sequential part: chunks are attached in file order
+	int lineOffset = 0;
+	for (int i = 0; i < actualCount; i++) {
+		preprocess_stitch(chunks[i].instructions, lineOffset, functionStack,
+				vm);
+		lineOffset += chunks[i].line_count;
+	}
+	free(chunks);
+}
+
+static void preprocess_chunkinit(preprocess_chunk_t *chunk, char *start,
+		char *end, vm_t *vm) {
+	chunk->start = start;
+	chunk->end = end;
+	chunk->set_delimiter = vm->set_delimiter;
+	chunk->arg_delimiter = vm->arg_delimiter;
+	chunk->comment_delimiter = vm->comment_delimiter;
+	chunk->instructions = list_init();
+	chunk->line_count = 0;
+}
+
+static void preprocess_parsechunk(void *arg) {
+	preprocess_chunk_t *chunk = arg;
+
+	char *current = chunk->start;
+	while (current < chunk->end) {
+		char *newline = memchr(current, '\n', chunk->end - current);
+		char *lineEnd = newline != NULL ? newline : chunk->end;
+
+		preprocess_line(current, lineEnd - current, chunk);
+		current = lineEnd + 1;
+	}
+}
+
+// Parses the lines from start to end (the first one is line lineOffset + 1) on this thread
+static void preprocess_text(char *start, char *end, int lineOffset,
+		list_t *functionStack, vm_t *vm) {
+	preprocess_chunk_t chunk;
+	preprocess_chunkinit(&chunk, start, end, vm);
+	preprocess_parsechunk(&chunk);
+	preprocess_stitch(chunk.instructions, lineOffset, functionStack, vm);
+}
+
+// Adds the function of the span with only its header parsed
+static void preprocess_header(source_span_t *span, list_t *functionStack,
+		vm_t *vm) {
+	char *newline = memchr(span->start, '\n', span->end - span->start);
+	int functionCount = vm->function_list->data_length;
+	preprocess_text(span->start, newline != NULL ? newline + 1 : span->end,
+			span->first_line - 1, functionStack, vm);
+	if (vm->function_list->data_length > functionCount) {
+		function_t *funct =
+				vm->function_list->data[vm->function_list->data_length - 1];
+		funct->body = span;
+		list_remove(functionStack->data_length - 1, functionStack);
+	}
+}
+
+// Parses the rest of a function that only has its header, except for the types
+static void preprocess_body(function_t *funct, vm_t *vm) {
+	source_span_t *span = funct->body;
+	funct->body = NULL;
+	char *newline = memchr(span->start, '\n', span->end - span->start);
+
+	// The functionend takes the function off of the stack, so it is on there twice
+	list_t *functionStack = list_init();
+	list_add(funct, functionStack);
+	list_add(funct, functionStack);
+	preprocess_text(newline + 1, span->end, span->first_line, functionStack,
+			vm);
+	list_free(functionStack);
+
+	preprocess_resolvejumps(funct, vm);
+	preprocess_optimizefunction(funct, 0, vm);
+}
+
+/**
+ * Parses one line of source code, skipping over blank lines and comments. Either way, the
+ * line is counted so that line numbers stay the same as the ones in the file.
+ */
+static void preprocess_line(char *text, int length, preprocess_chunk_t *chunk) {
+	chunk->line_count++;
+
+	// Indentation and trailing whitespace (like '\r') are not part of the instruction
+	while (length > 0 && isspace((unsigned char ) *text)) {
+		text++;
+		length--;
+	}
+	while (length > 0 && isspace((unsigned char ) text[length - 1]))
+		length--;
+
+	if (length == 0 || *text == chunk->comment_delimiter)
+		return;
+
 	string_t *line = string_init();
-	int readStatus;
-	while ((readStatus = readLine(line, stream)) != EOF) {
-		parsed_instruction_t *instr = parse(vm->set_delimiter,
-				vm->arg_delimiter, line);
+	string_appendn(line, text, length);
+	parsed_instruction_t *instr = parse(chunk->set_delimiter,
+			chunk->arg_delimiter, line);
+	instr->line_num = chunk->line_count;
+	list_add(instr, chunk->instructions);
+	string_free(line);
+}
+
+/**
+ * Attaches the instructions of one chunk to the functions they belong to. functionStack
+ * carries the function nesting from one chunk over to the next.
+ */
+static void preprocess_stitch(list_t *instructions, int lineOffset,
+		list_t *functionStack, vm_t *vm) {
+	for (int i = 0; i < instructions->data_length; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		instr->line_num += lineOffset;
+		function_t *current =
+				functionStack->data[functionStack->data_length - 1];
+
 		// If it is a function then store the args in a function_t struct
-		// function hello -> hh, j
-		if (string_startswith_s(instr->name, vm->function_declare)) {
-			list_add(function_init(instr->args), vm->function_list);
-			vm->currentFunction++;
+		// function hello, a, b
+		if (string_equals_s(instr->name, vm->function_declare)) {
+			if (instr->args->data_length == 0) {
+				throw_exception(NULL_POINTER_EXCEPTION, instr->line_num,
+						"A function needs a name!");
+				vm->error_count++;
+				parsed_instruction_free(instr);
+				continue;
+			}
+			string_t *name = instr->args->data[0];
+			list_remove(0, instr->args);
+
+			function_t *funct = function_init(name, instr->args);
+			list_add(funct, vm->function_list);
+			list_add(funct, functionStack);
+
+			// The arguments now belong to the function
+			string_free(instr->name);
+			memstats_free(instr, MEMSTATS_INSTRUCTIONS);
 			continue;
 		}
-		list_add(instr,
-				((function_t*) vm->function_list[vm->currentFunction])->parsed_instructions);
+		list_add(instr, current->parsed_instructions);
 
 		// If name is a function end, then the current function is below one
+		if (string_equals_s(instr->name, vm->function_end)) {
+			if (functionStack->data_length > 1)
+				list_remove(functionStack->data_length - 1, functionStack); // this is almost like a higher level stack
+			else {
+				throw_exception(INDEX_OUT_OF_BOUNDS_EXCEPTION, instr->line_num,
+						"Found a functionend without a function!");
+				vm->error_count++;
+			}
+		}
+	}
+	list_free(instructions);
+}
+
+/**
+ * Gives every gotoline with a constant line (like gotoline 5) the index of the instruction it
+ * goes to, so running it doesn't have to look for the line. Then every call that is followed
+ * by the end of the function (directly or through such a gotoline) is marked as a tail call.
+ */
+static void preprocess_resolvejumps(function_t *funct, vm_t *vm) {
+	list_t *instructions = funct->parsed_instructions;
+	for (int i = 0; i < instructions->data_length; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		if (!string_equals_s(instr->name, vm->goto_line)
+				|| instr->args->data_length == 0)
+			continue;
+
+		// Anything with a variable in it doesn't compile without the variables
+		int error;
+		double line = te_interp(((string_t*) instr->args->data[0])->text,
+				&error);
+		if (error == 0 && !isnan(line))
+			instr->jump_index = interpreter_findline((int) line, funct);
+	}
+
+	for (int i = 0; i < instructions->data_length; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		instr->tail_call = string_equals_s(instr->name, vm->tail_function)
+				|| (string_equals_s(instr->name, vm->goto_function)
+						&& preprocess_returnsafter(i, funct, vm));
+	}
+}
+
+// Whether the function always returns right after the instruction at index
+static bool preprocess_returnsafter(int index, function_t *funct, vm_t *vm) {
+	list_t *instructions = funct->parsed_instructions;
+	int next = index + 1;
+	// Every hop is counted, so a gotoline to itself doesn't loop forever
+	for (int hops = 0; hops < instructions->data_length; hops++) {
+		if (next >= instructions->data_length)
+			return true;
+		parsed_instruction_t *instr = instructions->data[next];
 		if (string_equals_s(instr->name, vm->function_end))
-			vm->currentFunction--; // this is almost like a higher level stack
+			return true;
+		if (!string_equals_s(instr->name, vm->goto_line)
+				|| instr->args->data_length != 1
+				|| instr->jump_index == PARSE_JUMP_UNRESOLVED)
+			return false;
+		next = instr->jump_index;
+	}
+	return false;
+}
 
-		string_reset(line); // more efficient than freeing the string every time :)
+// Moves a function that didn't change to where it is in the source now
+static void preprocess_movefunction(function_t *funct, int lineOffset,
+		vm_t *vm) {
+	list_t *instructions = funct->parsed_instructions;
+	for (int i = 0; i < instructions->data_length; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		instr->line_num += lineOffset;
+		instr->jump_index = PARSE_JUMP_UNRESOLVED; // gotoline uses line numbers of the file
 	}
-	// Free one string
-	string_free(line);
+	preprocess_resolvejumps(funct, vm);
 }
 
-void interpreter_execute(int lineNum, function_t *funct, vm_t *vm) {
-	if (vm->currentFunction <= 0)
+void interpreter_optimize(vm_t *vm) {
+	for (int i = 0; i < vm->function_list->data_length; i++)
+		preprocess_optimizefunction(vm->function_list->data[i], 0, vm);
+	preprocess_infertypes(vm);
+}
+
+// Gives the instructions from firstIndex on their opcodes
+static void preprocess_optimizefunction(function_t *funct, int firstIndex,
+		vm_t *vm) {
+	list_t *instructions = funct->parsed_instructions;
+	for (int i = firstIndex; i < instructions->data_length; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		instr->opcode = preprocess_opcode(instr->name, vm);
+	}
+
+	for (int i = firstIndex; i < instructions->data_length; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		parsed_instruction_t *next =
+				i + 1 < instructions->data_length ?
+						instructions->data[i + 1] : NULL;
+
+		// A lone name could be a string variable, and quotes are always a string
+		if (instr->opcode == OP_SET && instr->args->data_length == 2
+				&& !parse_isstring(instr->args->data[1])
+				&& !parse_isidentifier(instr->args->data[1]))
+			instr->opcode = OP_SET_EXPRESSION;
+		// The gotoline keeps its own opcode, since it can still be jumped to on its own
+		else if (instr->opcode == OP_ADD && next != NULL
+				&& next->opcode == OP_GOTOLINE)
+			instr->opcode = OP_ADD_GOTOLINE;
+	}
+}
+
+/**
+ * Finds the variables that can never hold a string, and gives the set and add instructions
+ * that change them opcodes that skip the type check. Variables are told apart by name only,
+ * since whether a name inside of a function is a global depends on what ran first.
+ *
+ * A name can hold a string if it's set to a string (or to a name that can), read into, gets
+ * the output of a command, or is an argument that a gotofunc passes one of those to. Strings
+ * from anywhere else (like the arguments of interpreter_call()) go through interpreter_guard(),
+ * which takes the numeric opcodes back out.
+ */
+static void preprocess_infertypes(vm_t *vm) {
+	if (vm->string_names != NULL)
+		map_free(vm->string_names);
+	vm->string_names = map_init();
+
+	// Strings flow through sets and calls, so it goes around until nothing changes
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (int i = 0; i < vm->function_list->data_length; i++)
+			changed |= preprocess_markstrings(vm->function_list->data[i], vm);
+	}
+
+	bool specialized = false, unloaded = false;
+	for (int i = 0; i < vm->function_list->data_length; i++) {
+		function_t *funct = vm->function_list->data[i];
+		specialized |= preprocess_specialize(funct, vm);
+		unloaded |= funct->body != NULL;
+	}
+	// Functions that are loaded later on still need the names
+	if (!specialized && !unloaded) {
+		map_free(vm->string_names);
+		vm->string_names = NULL;
+	}
+}
+
+/**
+ * Adds a function that was parsed after the rest of the program. It can only add names that
+ * hold strings, so the rest of the program only needs to be looked at again if it does.
+ */
+static void preprocess_inferfunction(function_t *funct, vm_t *vm) {
+	if (vm->string_names == NULL)
+		return; // a string went where it wasn't expected, so nothing is specialized anymore
+	if (preprocess_markstrings(funct, vm)) {
+		interpreter_deoptimize(vm);
+		preprocess_infertypes(vm);
+	} else {
+		preprocess_specialize(funct, vm);
+	}
+}
+
+// Returns true if the function gave any name that wasn't known to hold strings a string
+static bool preprocess_markstrings(function_t *funct, vm_t *vm) {
+	bool changed = false;
+	list_t *instructions = funct->parsed_instructions;
+	for (int i = 0; i < instructions->data_length; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		list_t *args = instr->args;
+		if (instr->opcode == OP_SET && args->data_length == 2
+				&& preprocess_maybestring(args->data[1], vm))
+			changed |= preprocess_markstring(args->data[0], vm);
+		else if (instr->opcode == OP_READ && args->data_length > 0)
+			changed |= preprocess_markstring(args->data[0], vm);
+		else if ((instr->opcode == OP_SYSTEM || instr->opcode == OP_SPAWN)
+				&& args->data_length > 2)
+			changed |= preprocess_markstring(args->data[2], vm);
+		else if ((instr->opcode == OP_GOTOFUNC || instr->opcode == OP_TAILFUNC)
+				&& args->data_length > 1) {
+			function_t *target = interpreter_findfunction(args->data[0], vm);
+			for (int j = 1; target != NULL && j < args->data_length
+							&& j <= target->args->data_length; j++)
+				if (preprocess_maybestring(args->data[j], vm))
+					changed |= preprocess_markstring(target->args->data[j - 1],
+							vm);
+		}
+	}
+	return changed;
+}
+
+// Returns true if any instruction got a numeric opcode
+static bool preprocess_specialize(function_t *funct, vm_t *vm) {
+	bool specialized = false;
+	list_t *instructions = funct->parsed_instructions;
+	for (int i = 0; i < instructions->data_length; i++) {
+		parsed_instruction_t *instr = instructions->data[i];
+		if (instr->args->data_length != 2
+				|| map_get(instr->args->data[0], vm->string_names) != NULL)
+			continue;
+		if (instr->opcode == OP_SET_EXPRESSION)
+			instr->opcode = OP_SET_NUMBER;
+		else if (instr->opcode == OP_ADD)
+			instr->opcode = OP_ADD_NUMBER;
+		else if (instr->opcode == OP_ADD_GOTOLINE)
+			instr->opcode = OP_ADD_NUMBER_GOTOLINE;
+		else
+			continue;
+		specialized = true;
+	}
+	return specialized;
+}
+
+// Returns true if the name wasn't known to hold strings yet
+static bool preprocess_markstring(string_t *name, vm_t *vm) {
+	return map_get(name, vm->string_names) == NULL
+			&& map_put(name, name, vm->string_names);
+}
+
+// A string in quotes, or a name that can hold a string
+static bool preprocess_maybestring(string_t *arg, vm_t *vm) {
+	return parse_isstring(arg) || map_get(arg, vm->string_names) != NULL;
+}
+
+// Called when a string goes into a variable, in case it was inferred to never hold one
+static void interpreter_guard(te_variable *var, vm_t *vm) {
+	if (vm->string_names == NULL)
 		return;
+	string_t name = { (char*) var->name, strlen(var->name), 0 };
+	if (map_get(&name, vm->string_names) == NULL)
+		interpreter_deoptimize(vm);
+}
 
-	for (int i = 0; i < funct->parsed_instructions->data_length; i++) {
-		// How to handle functions
-//		if (string_startswith_s(funct->parsed_instructions[lineNum], search) {
-//
-//		}
+/**
+ * Parses one line of the stream, and runs it if it is top level code. A function can be
+ * called once its functionend has been read.
+ */
+static void interpreter_streamline(char *text, int length,
+		stream_state_t *state, vm_t *vm) {
+	function_t *topLevel = vm->function_list->data[0];
+	list_t *instructions = topLevel->parsed_instructions;
+	int index = instructions->data_length, errorCount = vm->error_count;
 
-		// Core functions of the interpreter
-		if (string_equals(funct->parsed_instructions[lineNum],
-				vm->print_function))
-			interpreter_print(funct->parsed_instructions[lineNum]->data);
-		else if (string_equals(funct->parsed_instructions[lineNum],
-				vm->print_function))
-			interpreter_print();
+	state->chunk.instructions = list_init();
+	preprocess_line(text, length, &state->chunk);
+	preprocess_stitch(state->chunk.instructions, 0, state->function_stack, vm);
+	if (vm->error_count > errorCount) {
+		vm->running = false; // just like a program with errors doesn't run
+		return;
+	}
+	if (state->function_stack->data_length > 1)
+		return;
+
+	for (; state->function_count < vm->function_list->data_length;
+			state->function_count++) {
+		function_t *funct = vm->function_list->data[state->function_count];
+		preprocess_resolvejumps(funct, vm);
+		preprocess_optimizefunction(funct, 0, vm);
+		// Like interpreter_indexfunctions(), the first function with a name is the one called
+		if (map_put(funct->name, funct, vm->function_map))
+			vm->function_generation++;
 	}
+
+	if (index == instructions->data_length)
+		return; // a blank line, a comment or a functionend
+	parsed_instruction_t *instr = instructions->data[index];
+	if (state->skipping && instr->line_num < state->skip_line)
+		return;
+	state->skipping = false;
+
+	preprocess_optimizefunction(topLevel, index, vm);
+	if (instr->opcode == OP_GOTOLINE)
+		interpreter_streamjump(instr, state, vm);
+	else
+		interpreter_execute(index, topLevel, vm);
 }
 
-void interpreter_print(string_t *args) {
+// The lines before a gotoline have already been freed, so it can only skip lines
+static void interpreter_streamjump(parsed_instruction_t *instr,
+		stream_state_t *state, vm_t *vm) {
+	function_t *topLevel = vm->function_list->data[0];
+	if (instr->args->data_length == 0 || instr->args->data_length > 2) {
+		throw_exception(SYNTAX_EXCEPTION, instr->line_num,
+				"Expected a line number and an optional condition!");
+		interpreter_halt(vm);
+		return;
+	}
+	if (instr->args->data_length == 2
+			&& interpreter_evaluate(1, instr, topLevel, vm) == 0)
+		return;
 
+	int line = (int) interpreter_evaluate(0, instr, topLevel, vm);
+	if (vm->running && line <= instr->line_num) {
+		throw_exception(INDEX_OUT_OF_BOUNDS_EXCEPTION, instr->line_num,
+				"Line %d has already been run, and a stream only goes forward!",
+				line);
+		interpreter_halt(vm);
+	} else if (vm->running) {
+		state->skip_line = line;
+		state->skipping = true;
+	}
+}
+
+// Frees the top level instructions that have run
+static void interpreter_streamfree(function_t *topLevel) {
+	list_t *instructions = topLevel->parsed_instructions;
+	for (int i = 0; i < instructions->data_length; i++)
+		parsed_instruction_free(instructions->data[i]);
+	list_clear(instructions);
+}
+
+// Puts the checked opcodes back into every function
+static void interpreter_deoptimize(vm_t *vm) {
+	for (int i = 0; i < vm->function_list->data_length; i++) {
+		list_t *instructions =
+				((function_t*) vm->function_list->data[i])->parsed_instructions;
+		for (int j = 0; j < instructions->data_length; j++) {
+			parsed_instruction_t *instr = instructions->data[j];
+			if (instr->opcode == OP_SET_NUMBER)
+				instr->opcode = OP_SET_EXPRESSION;
+			else if (instr->opcode == OP_ADD_NUMBER)
+				instr->opcode = OP_ADD;
+			else if (instr->opcode == OP_ADD_NUMBER_GOTOLINE)
+				instr->opcode = OP_ADD_GOTOLINE;
+		}
+	}
+	map_free(vm->string_names);
+	vm->string_names = NULL;
+}
+
+static instruction_opcode preprocess_opcode(string_t *name, vm_t *vm) {
+	if (string_equals_s(name, vm->var_declare))
+		return OP_SET;
+	else if (string_equals_s(name, vm->var_add))
+		return OP_ADD;
+	else if (string_equals_s(name, vm->goto_line))
+		return OP_GOTOLINE;
+	else if (string_equals_s(name, vm->goto_function))
+		return OP_GOTOFUNC;
+	else if (string_equals_s(name, vm->tail_function))
+		return OP_TAILFUNC;
+	else if (string_equals_s(name, vm->print_function))
+		return OP_PRINT;
+	else if (string_equals_s(name, vm->read_function))
+		return OP_READ;
+	else if (string_equals_s(name, vm->write_function))
+		return OP_WRITE;
+	else if (string_equals_s(name, vm->system_function))
+		return OP_SYSTEM;
+	else if (string_equals_s(name, vm->spawn_function))
+		return OP_SPAWN;
+	else if (string_equals_s(name, vm->wait_function))
+		return OP_WAIT;
+	else if (string_equals_s(name, vm->function_end))
+		return OP_FUNCTIONEND;
+	return OP_UNKNOWN;
+}
+
+void interpreter_writecounts(FILE *stream, vm_t *vm) {
+	interpreter_loadall(vm); // the functions that never ran are written too
+	for (int i = 0; i < vm->function_list->data_length; i++) {
+		function_t *funct = vm->function_list->data[i];
+		for (int j = 0; j < funct->parsed_instructions->data_length; j++) {
+			parsed_instruction_t *instr = funct->parsed_instructions->data[j];
+			fprintf(stream, "%s\t%d\t%ld\t%s\n", funct->name->text,
+					instr->line_num, instr->run_count, instr->name->text);
+		}
+	}
 }
 
-static int readLine(string_t *str, FILE *stream) {
-	char letter;
-	while ((letter = fgetc(stream)) != EOF) {
-		if (letter == '\n')
+void interpreter_execute(int lineNum, function_t *funct, vm_t *vm) {
+	// Counting and timing have a copy of the loop to themselves, so the normal loop stays as fast
+	if (vm->count_instructions || vm->profile != NULL || vm->trace != NULL)
+		interpreter_dispatch(lineNum, funct, true, vm->sampler != NULL, vm);
+	else if (vm->sampler != NULL)
+		interpreter_dispatch(lineNum, funct, false, true, vm);
+	else
+		interpreter_dispatch(lineNum, funct, false, false, vm);
+}
+
+/**
+ * The loop that runs the instructions. It is always inlined, so every call gets a copy of the
+ * loop with or without the instrumentation (and with or without the sampler's call stack).
+ */
+static inline __attribute__((always_inline)) void interpreter_dispatch(
+		int lineNum, function_t *funct, bool instrumented, bool sampled,
+		vm_t *vm) {
+	list_t *instructions = funct->parsed_instructions;
+	profile_t *profile = instrumented ? vm->profile : NULL;
+	long long started = profile != NULL ? profile_now() : 0;
+	trace_t *trace = instrumented ? vm->trace : NULL;
+	sampler_t *sampler = sampled ? vm->sampler : NULL;
+	sampler_frame_t *top =
+			sampler != NULL ? sampler_enter(funct, false, sampler) : NULL;
+	for (int i = lineNum; vm->running; i++) {
+		// The end of a function returns to the gotofunc that called it
+		if (i >= instructions->data_length
+				|| ((parsed_instruction_t*) instructions->data[i])->opcode
+						== OP_FUNCTIONEND) {
+			if (vm->frame_count == 0) {
+				if (sampler != NULL)
+					sampler_leave(funct, sampler);
+				return;
+			}
+			call_frame_t frame = interpreter_leave(vm);
+			if (profile != NULL)
+				profile_leave(profile);
+			if (trace != NULL)
+				interpreter_tracecall(&frame, trace);
+			if (sampler != NULL)
+				top = sampler_leave(frame.caller, sampler);
+			if (frame.return_index == CALL_RETURN_EXTERNAL)
+				return;
+			funct = frame.caller;
+			instructions = funct->parsed_instructions;
+			i = frame.return_index;
+			continue;
+		}
+		parsed_instruction_t *instr = instructions->data[i];
+		if (instrumented)
+			instr->run_count++;
+		if (sampler != NULL)
+			atomic_store_explicit(&top->index, i, memory_order_relaxed);
+		// The time goes to the call the instruction started in
+		profile_node_t *node = profile != NULL ? profile->current : NULL;
+
+		// Core functions of the interpreter
+		switch (instr->opcode) {
+		case OP_SET:
+			interpreter_set(instr, funct, vm);
+			break;
+		case OP_SET_EXPRESSION:
+			interpreter_setexpression(instr, funct, false, vm);
+			break;
+		case OP_SET_NUMBER:
+			interpreter_setexpression(instr, funct, true, vm);
+			break;
+		case OP_ADD:
+			interpreter_add(instr, funct, false, vm);
+			break;
+		case OP_ADD_NUMBER:
+			interpreter_add(instr, funct, true, vm);
+			break;
+		case OP_ADD_GOTOLINE:
+		case OP_ADD_NUMBER_GOTOLINE:
+			interpreter_add(instr, funct,
+					instr->opcode == OP_ADD_NUMBER_GOTOLINE, vm);
+			if (!vm->running)
+				break;
+			i++;
+			if (instrumented)
+				((parsed_instruction_t*) instructions->data[i])->run_count++;
+			i = interpreter_gotoline(i, instructions->data[i], funct, vm);
+			break;
+		case OP_GOTOLINE:
+			i = interpreter_gotoline(i, instr, funct, vm);
+			break;
+		case OP_GOTOFUNC:
+		case OP_TAILFUNC: {
+			// Calls from the top level code have no call of their own to replace
+			bool tail = instr->tail_call && vm->frame_count > 0
+					&& vm->frames[vm->frame_count - 1].funct == funct;
+			function_t *target = interpreter_gotofunc(instr, vm);
+			if (target != NULL
+					&& interpreter_enter(target, 1, instr, funct, i, tail,
+							vm)) {
+				if (profile != NULL)
+					profile_enter(target, tail, profile);
+				if (sampler != NULL)
+					top = sampler_enter(target, tail, sampler);
+				if (trace != NULL && !tail)
+					vm->frames[vm->frame_count - 1].trace_started = trace_now();
+				funct = target;
+				instructions = funct->parsed_instructions;
+				i = -1; // the loop adds one
+			}
+			break;
+		}
+		case OP_PRINT:
+			interpreter_print(instr, funct, vm);
+			break;
+		case OP_READ:
+			interpreter_read(instr, funct, vm);
+			break;
+		case OP_WRITE:
+			interpreter_write(instr, funct, vm);
+			break;
+		case OP_SYSTEM:
+			interpreter_system(false, instr, funct, vm);
+			break;
+		case OP_SPAWN:
+			interpreter_system(true, instr, funct, vm);
+			break;
+		case OP_WAIT:
+			interpreter_wait(vm);
+			break;
+		default:
+			throw_exception(SYNTAX_EXCEPTION, instr->line_num,
+					"Unable to run \"%s\"!", instr->name->text);
+			interpreter_halt(vm);
+			break;
+		}
+
+		if (node != NULL) {
+			long long now = profile_now();
+			instr->profile_nanoseconds += now - started;
+			node->nanoseconds += now - started;
+			started = now;
+		}
+	}
+
+	// After an error, the calls that haven't returned are unwound (restoring their locals)
+	while (vm->frame_count > 0) {
+		if (profile != NULL)
+			profile_leave(profile);
+		if (interpreter_leave(vm).return_index == CALL_RETURN_EXTERNAL)
 			break;
+	}
+	if (sampler != NULL)
+		atomic_store_explicit(&sampler->depth, 0, memory_order_relaxed); // this loop started it
+}
+
+// print "x is ", x, "\n"
+void interpreter_print(parsed_instruction_t *instr, function_t *funct,
+		vm_t *vm) {
+	output_t *out = vm->output;
+	for (int i = 0; i < instr->args->data_length; i++) {
+		string_t *arg = instr->args->data[i];
+		// Strings inside of instructions don't change, so they don't need to be copied
+		if (parse_isstring(arg)) {
+			output_appendstatic(out, arg->text + 1, arg->text_length - 2);
+			continue;
+		}
+
+		te_variable *var = interpreter_findvariable(arg, funct, vm);
+		if (var != NULL && value_isstring(*(value_t*) var->address)) {
+			string_t *text = value_text(*(value_t*) var->address);
+			output_append(out, text->text, text->text_length);
+		} else {
+			double number = interpreter_evaluate(i, instr, funct, vm);
+			if (vm->running)
+				output_appenddouble(out, number);
+		}
+	}
+	output_endwrite(out);
+}
+
+/*
+ * read text, "input.txt"
+ * The file is read in the background. The variable is an empty string until the next wait,
+ * which is when it gets the contents of the file.
+ */
+static void interpreter_read(parsed_instruction_t *instr, function_t *funct,
+		vm_t *vm) {
+	if (instr->args->data_length != 2
+			|| !parse_isidentifier(instr->args->data[0])) {
+		throw_exception(SYNTAX_EXCEPTION, instr->line_num,
+				"Expected a variable name and a file!");
+		interpreter_halt(vm);
+		return;
+	}
+	string_t *path = interpreter_string(1, instr, funct, vm);
+	if (path == NULL)
+		return;
+
+	te_variable *var = interpreter_target(0, instr, funct, vm);
+	value_set((value_t*) var->address, value_string(string_init()));
+	interpreter_guard(var, vm);
+
+	if (vm->io == NULL)
+		interpreter_startio(vm);
+	asyncio_read(path->text, var, instr->line_num, vm->io);
+	string_free(path);
+}
+
+/*
+ * write "output.txt", "x is ", x, "\n"
+ * Replaces the file with everything after the file name (put together like print does). The
+ * write finishes in the background, but always before a later read of the same file.
+ */
+static void interpreter_write(parsed_instruction_t *instr, function_t *funct,
+		vm_t *vm) {
+	if (instr->args->data_length < 2) {
+		throw_exception(SYNTAX_EXCEPTION, instr->line_num,
+				"Expected a file and what to write into it!");
+		interpreter_halt(vm);
+		return;
+	}
+	string_t *path = interpreter_string(0, instr, funct, vm);
+	if (path == NULL)
+		return;
+	string_t *data = interpreter_concat(1, instr, funct, vm);
+	if (data == NULL) {
+		string_free(path);
+		return;
+	}
+
+	if (vm->io == NULL)
+		interpreter_startio(vm);
+	asyncio_write(path->text, data, NULL, instr->line_num, vm->io);
+	string_free(path);
+}
+
+// Starts the file I/O of the program when it first reads or writes
+static void interpreter_startio(vm_t *vm) {
+	vm->io = asyncio_init(vm->io_uring);
+	vm->io->trace = vm->trace;
+}
+
+/*
+ * system "ls -l", status, listing
+ * spawn "make all", status
+ * Runs a command, with the exit status and output going into the (optional) variables. Without
+ * an output variable, the output is printed. system waits for the command, while spawn starts it
+ * in the background: its variables are set (and its output printed) by the next wait, in the
+ * order the commands were spawned.
+ */
+static void interpreter_system(bool background, parsed_instruction_t *instr,
+		function_t *funct, vm_t *vm) {
+	int argCount = instr->args->data_length;
+	bool validArgs = argCount >= 1 && argCount <= 3;
+	for (int i = 1; validArgs && i < argCount; i++)
+		validArgs = parse_isidentifier(instr->args->data[i]);
+	if (!validArgs) {
+		throw_exception(SYNTAX_EXCEPTION, instr->line_num,
+				"Expected a command and optional status and output variables!");
+		interpreter_halt(vm);
+		return;
+	}
+	string_t *command = interpreter_string(0, instr, funct, vm);
+	if (command == NULL)
+		return;
+	te_variable *statusVar =
+			argCount > 1 ? interpreter_target(1, instr, funct, vm) : NULL;
+	te_variable *outputVar =
+			argCount > 2 ? interpreter_target(2, instr, funct, vm) : NULL;
+
+	// Commands in the background would write in between the prints, so their output is kept
+	bool capture = background || outputVar != NULL;
+	if (!capture)
+		output_flush(vm->output);
+	while (background
+			&& process_runningcount(vm->children) >= vm->max_children)
+		process_waitany(vm->children);
+
+	process_t *proc = process_spawn(command->text, capture, vm->output->fd);
+	if (proc == NULL) {
+		throw_exception(ERRNO_EXCEPTION, instr->line_num, "Unable to run %s",
+				command->text);
+		string_free(command);
+		interpreter_halt(vm);
+		return;
+	}
+	string_free(command);
+	proc->status_context = statusVar;
+	proc->output_context = outputVar;
+	proc->line_num = instr->line_num;
+	if (vm->trace != NULL)
+		proc->started = trace_now();
+
+	if (background) {
+		list_add(proc, vm->children);
+		return;
+	}
+	list_t *single = list_init();
+	list_add(proc, single);
+	process_waitany(single);
+	if (vm->trace != NULL)
+		trace_add(TRACE_PROCESS, "system", proc->command, proc->line_num,
+				proc->started, proc->finished, vm->trace);
+	interpreter_collect(proc, vm);
+	list_complete_free(&process_free, single);
+}
+
+// Moves the results of a finished command into its variables (or the output)
+static void interpreter_collect(process_t *proc, vm_t *vm) {
+	te_variable *statusVar = proc->status_context;
+	if (statusVar != NULL) {
+		value_set((value_t*) statusVar->address, value_number(proc->status));
+	}
+
+	if (proc->output == NULL)
+		return;
+	te_variable *outputVar = proc->output_context;
+	if (outputVar != NULL) {
+		value_set((value_t*) outputVar->address, value_string(proc->output));
+		interpreter_guard(outputVar, vm);
+		proc->output = NULL;
+	} else {
+		output_append(vm->output, proc->output->text,
+				proc->output->text_length);
+		output_endwrite(vm->output);
+	}
+}
+
+// wait
+static void interpreter_wait(vm_t *vm) {
+	if (vm->children->data_length > 0) {
+		while (process_runningcount(vm->children) > 0)
+			process_waitany(vm->children);
+		for (int i = 0; i < vm->children->data_length; i++) {
+			process_t *proc = vm->children->data[i];
+			if (vm->trace != NULL)
+				trace_add(TRACE_PROCESS, "spawn", proc->command,
+						proc->line_num, proc->started, proc->finished,
+						vm->trace);
+			interpreter_collect(proc, vm);
+			process_free(vm->children->data[i]);
+		}
+		list_clear(vm->children);
+	}
+	if (vm->io == NULL)
+		return;
+
+	list_t *finished = asyncio_wait(vm->io);
+	for (int i = 0; i < finished->data_length; i++) {
+		asyncio_request_t *request = finished->data[i];
+		if (request->error != 0) {
+			errno = request->error;
+			throw_exception(ERRNO_EXCEPTION, request->line_num,
+					"Unable to %s %s",
+					request->kind == ASYNCIO_READ ? "read" : "write",
+					request->path);
+			interpreter_halt(vm);
+		} else if (request->kind == ASYNCIO_READ) {
+			// The text that has been read is moved into the variable
+			value_set((value_t*) ((te_variable*) request->context)->address,
+					value_string(request->data));
+			request->data = NULL;
+		}
+	}
+	list_complete_free(&asyncio_request_free, finished);
+}
+
+// set x, 10 * 2
+// set name, "hello"
+static void interpreter_set(parsed_instruction_t *instr, function_t *funct,
+		vm_t *vm) {
+	if (instr->args->data_length != 2
+			|| !parse_isidentifier(instr->args->data[0])) {
+		throw_exception(SYNTAX_EXCEPTION, instr->line_num,
+				"Expected a variable name and a value!");
+		interpreter_halt(vm);
+		return;
+	}
+
+	if (instr->target_variable == NULL)
+		instr->target_variable = interpreter_target(0, instr, funct, vm);
+	te_variable *var = instr->target_variable;
+	if (interpreter_assign((value_t*) var->address, 1, instr, funct, vm)
+			&& value_isstring(*(value_t*) var->address))
+		interpreter_guard(var, vm);
+}
+
+// set x, i * 2 (the value can only be a number, so there is no need to look for strings)
+static void interpreter_setexpression(parsed_instruction_t *instr,
+		function_t *funct, bool numeric, vm_t *vm) {
+	if (instr->target_variable == NULL) {
+		if (!parse_isidentifier(instr->args->data[0])) {
+			interpreter_set(instr, funct, vm); // reports the error
+			return;
+		}
+		instr->target_variable = interpreter_target(0, instr, funct, vm);
+	}
+	te_variable *var = instr->target_variable;
+	double number = interpreter_evaluate(1, instr, funct, vm);
+	if (!vm->running)
+		return;
+
+	// A variable that is never a string has nothing to free
+	if (numeric)
+		*(value_t*) var->address = value_number(number);
+	else
+		value_set((value_t*) var->address, value_number(number));
+}
+
+// add x, 1 (numbers are added, anything is appended to strings)
+static void interpreter_add(parsed_instruction_t *instr, function_t *funct,
+		bool numeric, vm_t *vm) {
+	te_variable *var = instr->target_variable;
+	if (var == NULL && instr->args->data_length == 2)
+		var = instr->target_variable = interpreter_findvariable(
+				instr->args->data[0], funct, vm);
+	if (var == NULL) {
+		throw_exception(SYNTAX_EXCEPTION, instr->line_num,
+				"Expected a variable that has been set and a value!");
+		interpreter_halt(vm);
+		return;
+	}
+
+	value_t *value = (value_t*) var->address;
+	if (!numeric && value_isstring(*value)) {
+		value_t addition = { .bits = 0 };
+		if (!interpreter_assign(&addition, 1, instr, funct, vm))
+			return;
+
+		if (value_isstring(addition)) {
+			string_append_s(value_text(*value), value_text(addition));
+			string_free(value_text(addition));
+		} else {
+			char number[32];
+			snprintf(number, sizeof(number), "%.15g", addition.number);
+			string_append(value_text(*value), number);
+		}
+	} else {
+		*value = value_number(
+				value->number + interpreter_evaluate(1, instr, funct, vm));
+	}
+}
+
+// gotoline 5 or gotoline 5, i < 10
+static int interpreter_gotoline(int index, parsed_instruction_t *instr,
+		function_t *funct, vm_t *vm) {
+	if (instr->args->data_length == 0 || instr->args->data_length > 2) {
+		throw_exception(SYNTAX_EXCEPTION, instr->line_num,
+				"Expected a line number and an optional condition!");
+		interpreter_halt(vm);
+		return index;
+	}
+	if (instr->args->data_length == 2
+			&& interpreter_evaluate(1, instr, funct, vm) == 0)
+		return index;
+
+	if (instr->jump_index != PARSE_JUMP_UNRESOLVED)
+		return instr->jump_index - 1; // the loop in interpreter_execute() adds one
+
+	int line = (int) interpreter_evaluate(0, instr, funct, vm);
+	int target = interpreter_findline(line, funct);
+	if (vm->running && target != PARSE_JUMP_UNRESOLVED)
+		return target - 1;
+
+	if (vm->running) {
+		throw_exception(INDEX_OUT_OF_BOUNDS_EXCEPTION, instr->line_num,
+				"There is nothing to run at line %d!", line);
+		interpreter_halt(vm);
+	}
+	return index;
+}
+
+/**
+ * Returns the index of the first instruction at or after the line, or PARSE_JUMP_UNRESOLVED
+ * if there isn't any. Blank lines and comments are not instructions, so they go to the next
+ * instruction instead. Instructions are in the order of their lines, so a binary search works.
+ */
+static int interpreter_findline(int line, function_t *funct) {
+	list_t *instructions = funct->parsed_instructions;
+	int low = 0, high = instructions->data_length;
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+		if (((parsed_instruction_t*) instructions->data[middle])->line_num
+				< line)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low < instructions->data_length ? low : PARSE_JUMP_UNRESOLVED;
+}
+
+// gotofunc greet, "world", 3 or tailfunc greet, "world", 3
+static function_t* interpreter_gotofunc(parsed_instruction_t *instr,
+		vm_t *vm) {
+	// The function is only looked up again after the functions have changed
+	function_t *target = instr->call_target;
+	if ((target == NULL || instr->call_generation != vm->function_generation)
+			&& instr->args->data_length > 0) {
+		target = interpreter_findfunction(instr->args->data[0], vm);
+		instr->call_target = target;
+		instr->call_generation = vm->function_generation;
+	}
+	if (target == NULL) {
+		throw_exception(NULL_POINTER_EXCEPTION, instr->line_num,
+				"There is no function called \"%s\"!",
+				instr->args->data_length > 0 ?
+						((string_t*) instr->args->data[0])->text : "");
+		interpreter_halt(vm);
+	}
+	return target;
+}
+
+/**
+ * Pushes a call frame and binds the arguments of instr (starting from firstArg) to the
+ * arguments of the target, which are its first local variables. Every argument is evaluated
+ * (into slots above the stack) before anything is bound, so that "gotofunc f, b, a" inside of
+ * f(a, b) works. A tail call pops the frame of the caller first and returns to where the
+ * caller would have, so tail recursion runs in constant space. Returns false if the call
+ * can't be made.
+ */
+static bool interpreter_enter(function_t *target, int firstArg,
+		parsed_instruction_t *instr, function_t *caller, int returnIndex,
+		bool tail, vm_t *vm) {
+	if (target->body != NULL && !interpreter_loadbody(target, vm)) {
+		interpreter_halt(vm);
+		return false;
+	}
+	int argCount = instr->args->data_length - firstArg;
+	if (argCount == 1 && ((string_t*) instr->args->data[firstArg])->text_length == 0)
+		argCount = 0; // "gotofunc f," or a call without any arguments
+	if (argCount != target->args->data_length) {
+		throw_exception(INDEX_OUT_OF_BOUNDS_EXCEPTION, instr->line_num,
+				"%s needs %d argument(s), but got %d!", target->name->text,
+				target->args->data_length, argCount);
+		interpreter_halt(vm);
+		return false;
+	}
+	if (!tail && vm->frame_count >= vm->max_call_depth) {
+		throw_exception(STACK_OVERFLOW_EXCEPTION, instr->line_num,
+				"Calling %s goes deeper than %d calls!", target->name->text,
+				vm->max_call_depth);
+		interpreter_halt(vm);
+		return false;
+	}
+
+	// Slots are kept as indexes, since making room can move the slot stack
+	if (!interpreter_reserveslots(argCount, vm)) {
+		interpreter_halt(vm);
+		return false;
+	}
+	int valueIndex = vm->slot_count;
+	for (int i = 0; i < argCount; i++) {
+		call_slot_t *slot = &vm->slots[valueIndex + i];
+		slot->value.bits = 0;
+		if (vm->running)
+			interpreter_assign(&slot->value, firstArg + i, instr, caller, vm);
+	}
+	if (!vm->running) {
+		for (int i = 0; i < argCount; i++)
+			value_clear(&vm->slots[valueIndex + i].value);
+		return false;
+	}
+
+	long long traceStarted = 0;
+	if (tail) {
+		call_frame_t replaced = interpreter_leave(vm);
+		caller = replaced.caller;
+		returnIndex = replaced.return_index;
+		traceStarted = replaced.trace_started;
+	}
+
+	// The arguments go right above the locals that are saved
+	list_t *locals = target->local_variables;
+	int saveCount = target->active_count > 0 ? locals->data_length : 0;
+	int argIndex = vm->slot_count + saveCount;
+	int highest = argIndex > valueIndex ? argIndex : valueIndex;
+	if (!interpreter_reserveslots(highest + argCount - vm->slot_count, vm)) {
+		for (int i = 0; i < argCount; i++)
+			value_clear(&vm->slots[valueIndex + i].value);
+		interpreter_halt(vm);
+		return false;
+	}
+	if (argIndex != valueIndex)
+		memmove(&vm->slots[argIndex], &vm->slots[valueIndex],
+				argCount * sizeof(call_slot_t));
+	call_slot_t *saved = &vm->slots[vm->slot_count];
+	call_slot_t *values = &vm->slots[argIndex];
+
+	if (vm->frame_count == vm->frames_allocated) {
+		vm->frames_allocated *= 2;
+		vm->frames = realloc(vm->frames,
+				vm->frames_allocated * sizeof(call_frame_t));
+	}
+	call_frame_t *frame = &vm->frames[vm->frame_count++];
+	frame->funct = target;
+	frame->caller = caller;
+	frame->return_index = returnIndex;
+	frame->slot_count = saveCount;
+	frame->trace_started = traceStarted;
+	vm->slot_count += saveCount;
+	target->active_count++;
+
+	// The locals of the running call move onto the stack, and the new call starts fresh
+	for (int i = 0; i < locals->data_length; i++) {
+		te_variable *var = locals->data[i];
+		value_t *value = (value_t*) var->address;
+		if (i < saveCount)
+			saved[i].value = *value;
 		else
-			string_appendchar(str, letter);
+			value_clear(value);
+		value->bits = i < argCount ? values[i].value.bits : 0;
+		if (value_isstring(*value))
+			interpreter_guard(var, vm);
+	}
+	return true;
+}
+
+// Parses the rest of the function the first time it's called
+static bool interpreter_loadbody(function_t *funct, vm_t *vm) {
+	long long started = vm->trace != NULL ? trace_now() : 0;
+	int errorCount = vm->error_count;
+	preprocess_body(funct, vm);
+	preprocess_inferfunction(funct, vm);
+	if (vm->trace != NULL)
+		trace_span(TRACE_PHASE, "load body", funct->name->text, -1, started,
+				vm->trace);
+	return vm->error_count == errorCount;
+}
+
+// Records a call that took at least the threshold, at the line of the gotofunc that made it
+static void interpreter_tracecall(call_frame_t *frame, trace_t *trace) {
+	if (frame->trace_started == 0)
+		return;
+	long long now = trace_now();
+	if (now - frame->trace_started < trace->call_threshold)
+		return;
+	int lineNum = -1;
+	if (frame->return_index >= 0) {
+		parsed_instruction_t *call =
+				frame->caller->parsed_instructions->data[frame->return_index];
+		lineNum = call->line_num;
+	}
+	trace_add(TRACE_CALL, frame->funct->name->text, NULL, lineNum,
+			frame->trace_started, now, trace);
+}
+
+// Pops the newest call frame, giving the function back the locals of its previous call
+static call_frame_t interpreter_leave(vm_t *vm) {
+	call_frame_t frame = vm->frames[--vm->frame_count];
+	frame.funct->active_count--;
+	if (frame.slot_count == 0)
+		return frame; // the locals stay until the next call, like before
+
+	vm->slot_count -= frame.slot_count;
+	call_slot_t *saved = &vm->slots[vm->slot_count];
+	list_t *locals = frame.funct->local_variables;
+	for (int i = 0; i < locals->data_length; i++) {
+		te_variable *var = locals->data[i];
+		value_t *value = (value_t*) var->address;
+		// Locals created during the call that returned go back to 0
+		value_set(value, i < frame.slot_count ? saved[i].value : value_number(0));
+	}
+	return frame;
+}
+
+// Makes room for count more slots above the top of the slot stack
+static bool interpreter_reserveslots(int count, vm_t *vm) {
+	if (vm->slot_count + count <= vm->slots_allocated)
+		return true;
+
+	int newLength = vm->slots_allocated;
+	while (vm->slot_count + count > newLength)
+		newLength *= 2;
+	call_slot_t *newSlots = realloc(vm->slots, newLength * sizeof(call_slot_t));
+	if (newSlots == NULL) {
+		throw_exception(STACK_OVERFLOW_EXCEPTION, -1,
+				"Out of memory for local variables!");
+		return false;
+	}
+	vm->slots = newSlots;
+	vm->slots_allocated = newLength;
+	return true;
+}
+
+/**
+ * Stores the value of an argument: a string if it is in quotes or the name of a string
+ * variable, otherwise the result of the expression.
+ */
+static bool interpreter_assign(value_t *dest, int argIndex,
+		parsed_instruction_t *instr, function_t *funct, vm_t *vm) {
+	string_t *arg = instr->args->data[argIndex];
+	string_t *text = NULL;
+	if (parse_isstring(arg)) {
+		text = string_init();
+		string_appendn(text, arg->text + 1, arg->text_length - 2);
+	} else {
+		te_variable *source = interpreter_findvariable(arg, funct, vm);
+		if (source != NULL && value_isstring(*(value_t*) source->address))
+			text = string_copyvalueof_s(
+					value_text(*(value_t*) source->address));
+	}
+
+	if (text != NULL) {
+		value_set(dest, value_string(text));
+		return true;
+	}
+
+	double number = interpreter_evaluate(argIndex, instr, funct, vm);
+	if (!vm->running)
+		return false;
+	value_set(dest, value_number(number));
+	return true;
+}
+
+/**
+ * Returns a copy of an argument that has to be a string (a string in quotes or a string
+ * variable), or NULL if it isn't one.
+ */
+static string_t* interpreter_string(int argIndex, parsed_instruction_t *instr,
+		function_t *funct, vm_t *vm) {
+	value_t value = { .bits = 0 };
+	if (!interpreter_assign(&value, argIndex, instr, funct, vm))
+		return NULL;
+	if (!value_isstring(value)) {
+		throw_exception(SYNTAX_EXCEPTION, instr->line_num,
+				"Expected a string, but got %s!",
+				((string_t*) instr->args->data[argIndex])->text);
+		interpreter_halt(vm);
+		return NULL;
+	}
+	return value_text(value);
+}
+
+/**
+ * Puts the arguments from firstArg onwards together into a new string, the same way print
+ * writes them out.
+ */
+static string_t* interpreter_concat(int firstArg, parsed_instruction_t *instr,
+		function_t *funct, vm_t *vm) {
+	string_t *text = string_init();
+	for (int i = firstArg; i < instr->args->data_length; i++) {
+		value_t value = { .bits = 0 };
+		if (!interpreter_assign(&value, i, instr, funct, vm)) {
+			string_free(text);
+			return NULL;
+		}
+
+		if (value_isstring(value)) {
+			string_append_s(text, value_text(value));
+			string_free(value_text(value));
+		} else {
+			char number[32];
+			snprintf(number, sizeof(number), "%.15g", value.number);
+			string_append(text, number);
+		}
+	}
+	return text;
+}
+
+/**
+ * Evaluates an argument as an expression. The expression is compiled the first time and kept
+ * inside the instruction, which works because the address of a variable never changes.
+ */
+static double interpreter_evaluate(int argIndex, parsed_instruction_t *instr,
+		function_t *funct, vm_t *vm) {
+	if (instr->native_args != NULL && instr->native_args[argIndex] != NULL)
+		return instr->native_args[argIndex]();
+
+	if (instr->compiled_args == NULL)
+		instr->compiled_args = memstats_calloc(instr->args->data_length,
+				sizeof(te_expr*), MEMSTATS_EXPRESSIONS);
+
+	if (instr->compiled_args[argIndex] == NULL) {
+		// Local variables come first, so they hide global variables with the same name
+		list_t *locals = interpreter_variables(funct, vm);
+		list_t *globals = vm->global_variables;
+		int count = locals->data_length
+				+ (locals != globals ? globals->data_length : 0);
+		te_variable *lookup = memstats_malloc((count + 1) * sizeof(te_variable),
+				MEMSTATS_EXPRESSIONS);
+
+		int index = 0;
+		for (int i = 0; i < locals->data_length; i++)
+			lookup[index++] = *((te_variable*) locals->data[i]);
+		for (int i = 0; locals != globals && i < globals->data_length; i++)
+			lookup[index++] = *((te_variable*) globals->data[i]);
+
+		string_t *arg = instr->args->data[argIndex];
+		int error;
+		instr->compiled_args[argIndex] = te_compile(arg->text, lookup, count,
+				&error);
+		memstats_free(lookup, MEMSTATS_EXPRESSIONS);
+
+		if (instr->compiled_args[argIndex] == NULL) {
+			throw_exception(SYNTAX_EXCEPTION, instr->line_num,
+					"Unable to understand \"%s\" near character %d!",
+					arg->text, error);
+			interpreter_halt(vm);
+			return NAN;
+		}
+		if (argIndex < 32 && intexpr_check(instr->compiled_args[argIndex]))
+			instr->integer_args |= 1u << argIndex;
 	}
-	return letter;
+
+	if (vm->jit_enabled && ++instr->evaluation_count == JIT_HOT_THRESHOLD)
+		interpreter_jit(instr, vm);
+	double result;
+	if (argIndex < 32 && (instr->integer_args & (1u << argIndex)) != 0
+			&& intexpr_eval(instr->compiled_args[argIndex], &result))
+		return result;
+	return te_eval(instr->compiled_args[argIndex]);
+}
+
+// Compiles the expressions of a hot instruction, which stay interpreted if that doesn't work
+static void interpreter_jit(parsed_instruction_t *instr, vm_t *vm) {
+	if (vm->jit == NULL && (vm->jit = jit_init()) == NULL) {
+		vm->jit_enabled = false;
+		return;
+	}
+
+	instr->native_args = memstats_calloc(instr->args->data_length,
+			sizeof(jit_function), MEMSTATS_EXPRESSIONS);
+	for (int i = 0; i < instr->args->data_length; i++) {
+		te_expr *expr = instr->compiled_args[i];
+		// Constants and lone variables are already as fast as a call to machine code
+		if (expr != NULL && expr->type != TE_CONSTANT
+				&& expr->type != TE_VARIABLE)
+			instr->native_args[i] = jit_compile(expr, vm->jit);
+	}
+}
+
+static list_t* interpreter_variables(function_t *funct, vm_t *vm) {
+	// The top level code doesn't have local variables
+	if (funct == vm->function_list->data[0])
+		return vm->global_variables;
+	return funct->local_variables;
+}
+
+static te_variable* interpreter_findvariable(string_t *name,
+		function_t *funct, vm_t *vm) {
+	te_variable *var = variable_find(name, interpreter_variables(funct, vm));
+	if (var == NULL)
+		var = variable_find(name, vm->global_variables);
+	return var;
+}
+
+static void interpreter_halt(vm_t *vm) {
+	vm->running = false;
+	vm->error_count++;
 }
 
 parsed_instruction_t* parse(char set_delimiter, char arg_delimiter,
 		string_t *line) {
-	parsed_instruction_t *instr = malloc(sizeof(parsed_instruction_t));
+	parsed_instruction_t *instr = memstats_malloc(sizeof(parsed_instruction_t),
+			MEMSTATS_INSTRUCTIONS);
+	instr->line_num = 0;
+	instr->compiled_args = NULL;
+	instr->native_args = NULL;
+	instr->evaluation_count = 0;
+	instr->integer_args = 0;
+	instr->jump_index = PARSE_JUMP_UNRESOLVED;
+	instr->call_target = NULL;
+	instr->call_generation = 0;
+	instr->tail_call = false;
+	instr->opcode = OP_UNKNOWN;
+	instr->target_variable = NULL;
+	instr->run_count = 0;
+	instr->profile_nanoseconds = 0;
 
 	// New Syntax:
-	// print -> "hello"
-	// i -> 0
+	// print "hello"
+	// set i, 0
 	string_t **two_pairs = string_split(set_delimiter, line);
 
-	// If there is no "->" present in the system
-	if (two_pairs == NULL)
+	// If there are no arguments (like functionend)
+	if (two_pairs == NULL) {
 		instr->name = parse_filteronlywords(line);
+		instr->args = list_init();
+		return instr;
+	}
 
 	instr->name = two_pairs[0];
 	instr->args = parse_split_offquotes(arg_delimiter, two_pairs[1]);
 
+	string_free(two_pairs[1]);
+	free(two_pairs);
 	return instr;
 }
 
 static string_t* parse_filteronlywords(string_t *str) {
 	string_t *newStr = string_init();
 	for (int i = 0; i < str->text_length; i++)
-		if (isalnum(str->text[i]))
+		if (isalnum((unsigned char ) str->text[i]))
 			string_appendchar(newStr, str->text[i]);
 	return newStr;
 }
 
+/**
+ * Splits the arguments by the delimiter, except when the delimiter is inside of a string.
+ * Strings keep their quotes (so a string can be told apart from an expression later on)
+ * and escape sequences inside of them are replaced with the actual characters.
+ */
+static bool parse_isstring(string_t *arg) {
+	return arg->text_length >= 2 && (arg->text[0] == '"' || arg->text[0] == '\'')
+			&& arg->text[arg->text_length - 1] == arg->text[0];
+}
+
+// The same names that tinyexpr understands
+static bool parse_isidentifier(string_t *arg) {
+	if (arg->text_length == 0 || !isalpha((unsigned char ) arg->text[0]))
+		return false;
+	for (int i = 1; i < arg->text_length; i++)
+		if (!isalnum((unsigned char ) arg->text[i]) && arg->text[i] != '_')
+			return false;
+	return true;
+}
+
 static list_t* parse_split_offquotes(char delimiter, string_t *line) {
 	list_t *list = list_init();
 	string_t *currentString = string_init();
 
-	bool isString = false;
+	char quote = '\0'; // the quote that started the current string
 	for (int i = 0; i < line->text_length; i++) {
-		if (line[i] == '"' || line[i] == '\'') {
-			isString = !isString;
-		} else if (!isString && line[i] == delimiter) {
+		char letter = line->text[i];
+		if (quote != '\0' && letter == '\\' && i + 1 < line->text_length) {
+			switch (line->text[++i]) {
+			case 'n':
+				string_appendchar(currentString, '\n');
+				break;
+			case 't':
+				string_appendchar(currentString, '\t');
+				break;
+			default:
+				string_appendchar(currentString, line->text[i]);
+				break;
+			}
+		} else if (letter == '"' || letter == '\'') {
+			if (quote == '\0')
+				quote = letter;
+			else if (quote == letter)
+				quote = '\0';
+			string_appendchar(currentString, letter);
+		} else if (quote == '\0' && letter == delimiter) {
 			list_add(string_copyvalueof_s(currentString), list);
 			string_reset(currentString);
-		} else if (isString || line[i] != '\t') {
-			string_append(currentString, line[i]);
+		} else if (quote != '\0' || !isspace((unsigned char ) letter)) {
+			string_appendchar(currentString, letter);
 		}
-
 	}
-	list_add(currentString);
+	list_add(currentString, list);
 
 	return list;
 }
 
-function_t* function_init(list_t *args) {
-	function_t *funct = malloc(sizeof(function_t));
+function_t* function_init(string_t *name, list_t *args) {
+	function_t *funct = memstats_malloc(sizeof(function_t),
+			MEMSTATS_INSTRUCTIONS);
 
+	funct->name = name;
 	funct->args = args;
 	funct->parsed_instructions = list_init();
 	funct->local_variables = list_init();
+	funct->active_count = 0;
+	funct->body = NULL;
+
+	// The arguments are always the first locals, so calls can bind them by position
+	for (int i = 0; i < args->data_length; i++)
+		list_add(variable_init(((string_t*) args->data[i])->text),
+				funct->local_variables);
 	return funct;
 }
 
 void function_free(void *funct) {
-	list_complete_free(&te_free, ((function_t*) funct)->local_variables);
+	string_free(((function_t*) funct)->name);
+	list_complete_free(&string_free, ((function_t*) funct)->args);
+	list_complete_free(&variable_free, ((function_t*) funct)->local_variables);
 	list_complete_free(&parsed_instruction_free,
 			((function_t*) funct)->parsed_instructions);
+	memstats_free(funct, MEMSTATS_INSTRUCTIONS);
 }
 
 void parsed_instruction_free(void *instruction) {
+	parsed_instruction_t *instr = instruction;
+	if (instr->compiled_args != NULL) {
+		for (int i = 0; i < instr->args->data_length; i++)
+			te_free(instr->compiled_args[i]);
+		memstats_free(instr->compiled_args, MEMSTATS_EXPRESSIONS);
+	}
+	// The code itself belongs to the jit_t of the vm_t
+	memstats_free(instr->native_args, MEMSTATS_EXPRESSIONS);
+
 	string_free(((parsed_instruction_t*) instruction)->name);
 	list_complete_free(&string_free,
 			((parsed_instruction_t*) instruction)->args);
+	memstats_free(instruction, MEMSTATS_INSTRUCTIONS);
+}
+
+te_variable* variable_init(char *name) {
+	te_variable *var = memstats_malloc(sizeof(te_variable), MEMSTATS_VARIABLES);
+
+	size_t nameLength = strlen(name) + 1;
+	var->name = memcpy(memstats_malloc(nameLength, MEMSTATS_VARIABLES), name,
+			nameLength);
+	var->address = memstats_calloc(1, sizeof(value_t), MEMSTATS_VARIABLES);
+	var->type = TE_VARIABLE;
+	var->context = NULL;
+	return var;
+}
+
+// Finds the variable an instruction puts its result into, creating it if needed
+static te_variable* interpreter_target(int argIndex,
+		parsed_instruction_t *instr, function_t *funct, vm_t *vm) {
+	string_t *name = instr->args->data[argIndex];
+	te_variable *var = interpreter_findvariable(name, funct, vm);
+	if (var == NULL) {
+		var = variable_init(name->text);
+		list_add(var, interpreter_variables(funct, vm));
+	}
+	return var;
+}
+
+static te_variable* variable_find(string_t *name, list_t *variables) {
+	for (int i = 0; i < variables->data_length; i++)
+		if (string_equals(name, (char*) ((te_variable*) variables->data[i])->name))
+			return variables->data[i];
+	return NULL;
+}
+
+static void variable_reset(void *var) {
+	value_clear((value_t*) ((te_variable*) var)->address);
+}
+
+void variable_free(void *var) {
+	value_t *value = (value_t*) ((te_variable*) var)->address;
+	value_clear(value);
+	memstats_free(value, MEMSTATS_VARIABLES);
+	memstats_free((char*) ((te_variable*) var)->name, MEMSTATS_VARIABLES);
+	memstats_free(var, MEMSTATS_VARIABLES);
 }
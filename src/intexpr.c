@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * intexpr.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/intexpr.h"
+#include "../deps/tinyexpr/tinyexpr.h"
+
+#define INTEXPR_TYPE_MASK(TYPE) ((TYPE) & 0x1F)
+#define INTEXPR_MAX_DEPTH 64 // like JIT_MAX_DEPTH, so the JIT can compile everything this takes
+
+// Static Prototypes
+static bool intexpr_shape(const te_expr *expr, int depth);
+static bool intexpr_nested(const te_expr *expr, bool consumed);
+static bool intexpr_arithmetic(te_operator op);
+static bool intexpr_evaluate(const te_expr *expr, long long *result);
+
+bool intexpr_check(const te_expr *expr) {
+	return intexpr_shape(expr, 0) && intexpr_nested(expr, false);
+}
+
+bool intexpr_eval(const te_expr *expr, double *result) {
+	long long integer;
+	if (!intexpr_evaluate(expr, &integer))
+		return false;
+	*result = (double) integer;
+	return true;
+}
+
+bool intexpr_integer(double number, long long *integer) {
+	// 2^63 is the first double that int64 can't hold (and NaN fails both comparisons)
+	if (!(number >= -9223372036854775808.0 && number < 9223372036854775808.0))
+		return false;
+	*integer = (long long) number;
+	double back = (double) *integer;
+	return memcmp(&back, &number, sizeof(double)) == 0;
+}
+
+static bool intexpr_shape(const te_expr *expr, int depth) {
+	if (depth > INTEXPR_MAX_DEPTH)
+		return false;
+	long long integer;
+	switch (INTEXPR_TYPE_MASK(expr->type)) {
+	case TE_CONSTANT:
+		return intexpr_integer(expr->value, &integer);
+	case TE_VARIABLE:
+		return true;
+	case TE_FUNCTION1:
+		return te_function_operator(expr->function) == TE_OPERATOR_NEGATE
+				&& intexpr_shape(expr->parameters[0], depth + 1);
+	case TE_FUNCTION2:
+		switch (te_function_operator(expr->function)) {
+		case TE_OPERATOR_ADD:
+		case TE_OPERATOR_SUB:
+		case TE_OPERATOR_MUL:
+		case TE_OPERATOR_COMMA:
+		case TE_OPERATOR_GREATER:
+		case TE_OPERATOR_GREATER_EQ:
+		case TE_OPERATOR_LOWER:
+		case TE_OPERATOR_LOWER_EQ:
+		case TE_OPERATOR_EQUAL:
+		case TE_OPERATOR_NOT_EQUAL:
+			return intexpr_shape(expr->parameters[0], depth + 1)
+					&& intexpr_shape(expr->parameters[1], depth + 1);
+		default:
+			return false;
+		}
+	default:
+		return false;
+	}
+}
+
+/**
+ * Looks for + - or * whose result goes into another operation (consumed). Negation and the
+ * right side of a comma pass a value on unchanged, so they don't count as using it.
+ */
+static bool intexpr_nested(const te_expr *expr, bool consumed) {
+	int type = INTEXPR_TYPE_MASK(expr->type);
+	if (type == TE_VARIABLE || type == TE_CONSTANT)
+		return false;
+	te_operator op = te_function_operator(expr->function);
+	if (op == TE_OPERATOR_NEGATE)
+		return intexpr_nested(expr->parameters[0], consumed);
+	if (op == TE_OPERATOR_COMMA)
+		return intexpr_nested(expr->parameters[0], false)
+				|| intexpr_nested(expr->parameters[1], consumed);
+	if (consumed && intexpr_arithmetic(op))
+		return true;
+	return intexpr_nested(expr->parameters[0], true)
+			|| intexpr_nested(expr->parameters[1], true);
+}
+
+static bool intexpr_arithmetic(te_operator op) {
+	return op == TE_OPERATOR_ADD || op == TE_OPERATOR_SUB
+			|| op == TE_OPERATOR_MUL;
+}
+
+static bool intexpr_evaluate(const te_expr *expr, long long *result) {
+	switch (INTEXPR_TYPE_MASK(expr->type)) {
+	case TE_CONSTANT:
+		return intexpr_integer(expr->value, result);
+	case TE_VARIABLE:
+		return intexpr_integer(*expr->bound, result);
+	case TE_FUNCTION1: // negation, the only one intexpr_shape() lets through
+		return intexpr_evaluate(expr->parameters[0], result)
+				&& !__builtin_sub_overflow(0, *result, result);
+	default:
+		break;
+	}
+
+	long long left, right;
+	if (!intexpr_evaluate(expr->parameters[0], &left)
+			|| !intexpr_evaluate(expr->parameters[1], &right))
+		return false;
+	switch (te_function_operator(expr->function)) {
+	case TE_OPERATOR_ADD:
+		return !__builtin_add_overflow(left, right, result);
+	case TE_OPERATOR_SUB:
+		return !__builtin_sub_overflow(left, right, result);
+	case TE_OPERATOR_MUL:
+		return !__builtin_mul_overflow(left, right, result);
+	case TE_OPERATOR_COMMA:
+		*result = right;
+		return true;
+	case TE_OPERATOR_GREATER:
+		*result = left > right;
+		return true;
+	case TE_OPERATOR_GREATER_EQ:
+		*result = left >= right;
+		return true;
+	case TE_OPERATOR_LOWER:
+		*result = left < right;
+		return true;
+	case TE_OPERATOR_LOWER_EQ:
+		*result = left <= right;
+		return true;
+	case TE_OPERATOR_EQUAL:
+		*result = left == right;
+		return true;
+	case TE_OPERATOR_NOT_EQUAL:
+		*result = left != right;
+		return true;
+	default:
+		return false;
+	}
+}
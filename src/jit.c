@@ -0,0 +1,443 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * jit.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+
+#include "../include/jit.h"
+#include "../include/intexpr.h"
+#include "../deps/tinyexpr/tinyexpr.h"
+
+#if defined(__x86_64__)
+
+#define JIT_TYPE_MASK(TYPE) ((TYPE) & 0x1F)
+#define JIT_ARITY(TYPE) ((TYPE) & 0x07)
+
+// Predicates of cmpsd
+#define JIT_CMP_EQ 0
+#define JIT_CMP_LT 1
+#define JIT_CMP_LE 2
+#define JIT_CMP_NEQ 4
+
+// Condition codes of jcc and setcc
+#define JIT_CC_OVERFLOW 0x0
+#define JIT_CC_EQUAL 0x4
+#define JIT_CC_NOT_EQUAL 0x5
+#define JIT_CC_LOWER 0xC
+#define JIT_CC_GREATER_EQ 0xD
+#define JIT_CC_LOWER_EQ 0xE
+#define JIT_CC_GREATER 0xF
+
+/*
+ * Code is generated like for a stack machine: every expression leaves its value in xmm0 (rax
+ * for integers), and the values that are still needed are pushed onto the machine stack in
+ * between.
+ */
+typedef struct {
+	unsigned char *code;
+	size_t length, capacity;
+	int stack_depth; // 8 byte values pushed since the function started
+	bool failed;
+	// The jumps to the double version of an integer expression, each holding the offset of the
+	// previous one until they are patched (-1 ends the chain)
+	long bailouts;
+} jit_emitter_t;
+
+// Static Prototypes
+static void jit_emit(jit_emitter_t *emitter, int count, ...);
+static void jit_emitimmediate(jit_emitter_t *emitter, uint64_t value);
+static void jit_loadconstant(jit_emitter_t *emitter, double value);
+static void jit_push(jit_emitter_t *emitter);
+static void jit_pop(jit_emitter_t *emitter, int xmm);
+static void jit_expression(const te_expr *expr, int depth,
+		jit_emitter_t *emitter);
+static void jit_compare(int predicate, bool swap, jit_emitter_t *emitter);
+static void jit_call(const te_expr *expr, int depth, jit_emitter_t *emitter);
+static void jit_integer(const te_expr *expr, jit_emitter_t *emitter);
+static void jit_bailout(int condition, jit_emitter_t *emitter);
+
+jit_t* jit_init() {
+	unsigned char *buffer = mmap(NULL, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE,
+	MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buffer == MAP_FAILED)
+		return NULL;
+
+	jit_t *jit = malloc(sizeof(jit_t));
+	jit->buffer = buffer;
+	jit->used = 0;
+	jit->full = false;
+	return jit;
+}
+
+jit_function jit_compile(const te_expr *expr, jit_t *jit) {
+	if (jit->full)
+		return NULL;
+
+	// The buffer is never writable and executable at the same time
+	if (mprotect(jit->buffer, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE) != 0) {
+		jit->full = true;
+		return NULL;
+	}
+	jit_emitter_t emitter = { jit->buffer + jit->used, 0, JIT_BUFFER_SIZE
+			- jit->used, 0, false, -1 };
+
+	// Integer expressions try the integers first, and jump to the doubles if they can't be used
+	if (intexpr_check(expr)) {
+		jit_emit(&emitter, 1, 0x53); // push rbx
+		jit_emit(&emitter, 3, 0x48, 0x89, 0xE3); // mov rbx, rsp
+		jit_integer(expr, &emitter);
+		jit_emit(&emitter, 5, 0xF2, 0x48, 0x0F, 0x2A, 0xC0); // cvtsi2sd xmm0, rax
+		jit_emit(&emitter, 1, 0x5B); // pop rbx
+		jit_emit(&emitter, 1, 0xC3); // ret
+
+		// Every bailout leaves the stack of the integers behind
+		for (long jump = emitter.bailouts; jump != -1 && !emitter.failed;) {
+			int32_t next, target = (int32_t) (emitter.length - (jump + 4));
+			memcpy(&next, emitter.code + jump, sizeof(next));
+			memcpy(emitter.code + jump, &target, sizeof(target));
+			jump = next;
+		}
+		jit_emit(&emitter, 3, 0x48, 0x89, 0xDC); // mov rsp, rbx
+		jit_emit(&emitter, 1, 0x5B); // pop rbx
+		emitter.stack_depth = 0;
+	}
+
+	// The return address leaves the stack 8 bytes off, which is fixed right away
+	jit_emit(&emitter, 4, 0x48, 0x83, 0xEC, 0x08); // sub rsp, 8
+	jit_expression(expr, 0, &emitter);
+	jit_emit(&emitter, 4, 0x48, 0x83, 0xC4, 0x08); // add rsp, 8
+	jit_emit(&emitter, 1, 0xC3); // ret
+
+	jit_function function = NULL;
+	if (!emitter.failed) {
+		function = (jit_function) (jit->buffer + jit->used);
+		// Functions start 16 byte aligned, which is what processors like to jump to
+		jit->used = (jit->used + emitter.length + 15) & ~(size_t) 15;
+	} else if (emitter.length >= emitter.capacity) {
+		jit->full = true;
+	}
+
+	if (mprotect(jit->buffer, JIT_BUFFER_SIZE, PROT_READ | PROT_EXEC) != 0) {
+		jit->full = true;
+		return NULL;
+	}
+	return function;
+}
+
+void jit_free(jit_t *jit) {
+	munmap(jit->buffer, JIT_BUFFER_SIZE);
+	free(jit);
+}
+
+static void jit_emit(jit_emitter_t *emitter, int count, ...) {
+	if (emitter->length + count > emitter->capacity) {
+		emitter->failed = true;
+		emitter->length = emitter->capacity;
+		return;
+	}
+	va_list bytes;
+	va_start(bytes, count);
+	for (int i = 0; i < count; i++)
+		emitter->code[emitter->length++] = (unsigned char) va_arg(bytes, int);
+	va_end(bytes);
+}
+
+// mov rax, value
+static void jit_emitimmediate(jit_emitter_t *emitter, uint64_t value) {
+	jit_emit(emitter, 2, 0x48, 0xB8);
+	for (int i = 0; i < 8; i++)
+		jit_emit(emitter, 1, (int) ((value >> (8 * i)) & 0xFF));
+}
+
+// xmm0 = value
+static void jit_loadconstant(jit_emitter_t *emitter, double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	jit_emitimmediate(emitter, bits);
+	jit_emit(emitter, 5, 0x66, 0x48, 0x0F, 0x6E, 0xC0); // movq xmm0, rax
+}
+
+// Pushes xmm0
+static void jit_push(jit_emitter_t *emitter) {
+	jit_emit(emitter, 4, 0x48, 0x83, 0xEC, 0x08); // sub rsp, 8
+	jit_emit(emitter, 5, 0xF2, 0x0F, 0x11, 0x04, 0x24); // movsd [rsp], xmm0
+	emitter->stack_depth++;
+}
+
+// Pops into xmm0 to xmm7
+static void jit_pop(jit_emitter_t *emitter, int xmm) {
+	jit_emit(emitter, 5, 0xF2, 0x0F, 0x10, 0x04 | (xmm << 3), 0x24); // movsd xmmN, [rsp]
+	jit_emit(emitter, 4, 0x48, 0x83, 0xC4, 0x08); // add rsp, 8
+	emitter->stack_depth--;
+}
+
+static void jit_expression(const te_expr *expr, int depth,
+		jit_emitter_t *emitter) {
+	if (depth > JIT_MAX_DEPTH || emitter->failed) {
+		emitter->failed = true;
+		return;
+	}
+
+	switch (JIT_TYPE_MASK(expr->type)) {
+	case TE_CONSTANT:
+		jit_loadconstant(emitter, expr->value);
+		return;
+	case TE_VARIABLE:
+		jit_emitimmediate(emitter, (uint64_t) (uintptr_t) expr->bound);
+		jit_emit(emitter, 4, 0xF2, 0x0F, 0x10, 0x00); // movsd xmm0, [rax]
+		return;
+	case TE_FUNCTION0:
+	case TE_FUNCTION1:
+	case TE_FUNCTION2:
+	case TE_FUNCTION3:
+	case TE_FUNCTION4:
+	case TE_FUNCTION5:
+	case TE_FUNCTION6:
+	case TE_FUNCTION7:
+		break;
+	default:
+		emitter->failed = true; // closures need their context, which isn't worth it
+		return;
+	}
+
+	te_operator op = te_function_operator(expr->function);
+	int arity = JIT_ARITY(expr->type);
+	if (op == TE_OPERATOR_NONE && arity == 1 && expr->function == sqrt) {
+		jit_expression(expr->parameters[0], depth + 1, emitter);
+		jit_emit(emitter, 4, 0xF2, 0x0F, 0x51, 0xC0); // sqrtsd xmm0, xmm0
+		return;
+	}
+	if (op == TE_OPERATOR_NONE) {
+		jit_call(expr, depth, emitter);
+		return;
+	}
+	if (op == TE_OPERATOR_NEGATE) {
+		jit_expression(expr->parameters[0], depth + 1, emitter);
+		jit_emitimmediate(emitter, 0x8000000000000000ull);
+		jit_emit(emitter, 5, 0x66, 0x48, 0x0F, 0x6E, 0xC8); // movq xmm1, rax
+		jit_emit(emitter, 4, 0x66, 0x0F, 0x57, 0xC1); // xorpd xmm0, xmm1
+		return;
+	}
+	if (op == TE_OPERATOR_COMMA) {
+		jit_expression(expr->parameters[0], depth + 1, emitter);
+		jit_expression(expr->parameters[1], depth + 1, emitter);
+		return;
+	}
+
+	// Binary operators: the right side goes into xmm1, the left side into xmm0
+	jit_expression(expr->parameters[1], depth + 1, emitter);
+	jit_push(emitter);
+	jit_expression(expr->parameters[0], depth + 1, emitter);
+	jit_pop(emitter, 1);
+
+	switch (op) {
+	case TE_OPERATOR_ADD:
+		jit_emit(emitter, 4, 0xF2, 0x0F, 0x58, 0xC1); // addsd xmm0, xmm1
+		break;
+	case TE_OPERATOR_SUB:
+		jit_emit(emitter, 4, 0xF2, 0x0F, 0x5C, 0xC1); // subsd xmm0, xmm1
+		break;
+	case TE_OPERATOR_MUL:
+		jit_emit(emitter, 4, 0xF2, 0x0F, 0x59, 0xC1); // mulsd xmm0, xmm1
+		break;
+	case TE_OPERATOR_DIVIDE:
+		jit_emit(emitter, 4, 0xF2, 0x0F, 0x5E, 0xC1); // divsd xmm0, xmm1
+		break;
+	case TE_OPERATOR_EQUAL:
+		jit_compare(JIT_CMP_EQ, false, emitter);
+		break;
+	case TE_OPERATOR_NOT_EQUAL:
+		jit_compare(JIT_CMP_NEQ, false, emitter);
+		break;
+	case TE_OPERATOR_LOWER:
+		jit_compare(JIT_CMP_LT, false, emitter);
+		break;
+	case TE_OPERATOR_LOWER_EQ:
+		jit_compare(JIT_CMP_LE, false, emitter);
+		break;
+	case TE_OPERATOR_GREATER:
+		jit_compare(JIT_CMP_LT, true, emitter); // a > b is b < a
+		break;
+	case TE_OPERATOR_GREATER_EQ:
+		jit_compare(JIT_CMP_LE, true, emitter);
+		break;
+	default:
+		emitter->failed = true;
+		break;
+	}
+}
+
+// Compares xmm0 with xmm1, leaving 1.0 or 0.0 in xmm0 (like the comparisons of tinyexpr)
+static void jit_compare(int predicate, bool swap, jit_emitter_t *emitter) {
+	if (swap) {
+		jit_emit(emitter, 5, 0xF2, 0x0F, 0xC2, 0xC8, predicate); // cmpsd xmm1, xmm0, predicate
+		jit_emit(emitter, 4, 0x66, 0x0F, 0x28, 0xC1); // movapd xmm0, xmm1
+	} else {
+		jit_emit(emitter, 5, 0xF2, 0x0F, 0xC2, 0xC1, predicate); // cmpsd xmm0, xmm1, predicate
+	}
+	// The result is a mask of all ones or zeros, which turns into 1.0 or 0.0
+	jit_emitimmediate(emitter, 0x3FF0000000000000ull);
+	jit_emit(emitter, 5, 0x66, 0x48, 0x0F, 0x6E, 0xC8); // movq xmm1, rax
+	jit_emit(emitter, 4, 0x66, 0x0F, 0x54, 0xC1); // andpd xmm0, xmm1
+}
+
+/**
+ * Leaves the value of an expression that intexpr_check() accepted in rax. The variables have to
+ * be whole numbers and nothing can overflow, or the code bails out to the double version.
+ */
+static void jit_integer(const te_expr *expr, jit_emitter_t *emitter) {
+	if (emitter->failed)
+		return;
+	long long integer;
+	switch (JIT_TYPE_MASK(expr->type)) {
+	case TE_CONSTANT:
+		intexpr_integer(expr->value, &integer);
+		jit_emitimmediate(emitter, (uint64_t) integer);
+		return;
+	case TE_VARIABLE:
+		// Converting there and back has to give the same bits (NaN, -0.0 and 0.5 don't)
+		jit_emitimmediate(emitter, (uint64_t) (uintptr_t) expr->bound);
+		jit_emit(emitter, 4, 0xF2, 0x0F, 0x10, 0x00); // movsd xmm0, [rax]
+		jit_emit(emitter, 5, 0xF2, 0x48, 0x0F, 0x2C, 0xC0); // cvttsd2si rax, xmm0
+		jit_emit(emitter, 5, 0xF2, 0x48, 0x0F, 0x2A, 0xC8); // cvtsi2sd xmm1, rax
+		jit_emit(emitter, 5, 0x66, 0x48, 0x0F, 0x7E, 0xC2); // movq rdx, xmm0
+		jit_emit(emitter, 5, 0x66, 0x48, 0x0F, 0x7E, 0xC9); // movq rcx, xmm1
+		jit_emit(emitter, 3, 0x48, 0x39, 0xCA); // cmp rdx, rcx
+		jit_bailout(JIT_CC_NOT_EQUAL, emitter);
+		return;
+	case TE_FUNCTION1: // negation
+		jit_integer(expr->parameters[0], emitter);
+		jit_emit(emitter, 3, 0x48, 0xF7, 0xD8); // neg rax
+		jit_bailout(JIT_CC_OVERFLOW, emitter);
+		return;
+	default:
+		break;
+	}
+
+	// The right side goes into rcx, the left side into rax
+	jit_integer(expr->parameters[1], emitter);
+	jit_emit(emitter, 1, 0x50); // push rax
+	jit_integer(expr->parameters[0], emitter);
+	jit_emit(emitter, 1, 0x59); // pop rcx
+
+	int condition;
+	switch (te_function_operator(expr->function)) {
+	case TE_OPERATOR_ADD:
+		jit_emit(emitter, 3, 0x48, 0x01, 0xC8); // add rax, rcx
+		jit_bailout(JIT_CC_OVERFLOW, emitter);
+		return;
+	case TE_OPERATOR_SUB:
+		jit_emit(emitter, 3, 0x48, 0x29, 0xC8); // sub rax, rcx
+		jit_bailout(JIT_CC_OVERFLOW, emitter);
+		return;
+	case TE_OPERATOR_MUL:
+		jit_emit(emitter, 4, 0x48, 0x0F, 0xAF, 0xC1); // imul rax, rcx
+		jit_bailout(JIT_CC_OVERFLOW, emitter);
+		return;
+	case TE_OPERATOR_COMMA:
+		jit_emit(emitter, 3, 0x48, 0x89, 0xC8); // mov rax, rcx
+		return;
+	case TE_OPERATOR_GREATER:
+		condition = JIT_CC_GREATER;
+		break;
+	case TE_OPERATOR_GREATER_EQ:
+		condition = JIT_CC_GREATER_EQ;
+		break;
+	case TE_OPERATOR_LOWER:
+		condition = JIT_CC_LOWER;
+		break;
+	case TE_OPERATOR_LOWER_EQ:
+		condition = JIT_CC_LOWER_EQ;
+		break;
+	case TE_OPERATOR_EQUAL:
+		condition = JIT_CC_EQUAL;
+		break;
+	case TE_OPERATOR_NOT_EQUAL:
+		condition = JIT_CC_NOT_EQUAL;
+		break;
+	default:
+		emitter->failed = true;
+		return;
+	}
+	jit_emit(emitter, 3, 0x48, 0x39, 0xC8); // cmp rax, rcx
+	jit_emit(emitter, 3, 0x0F, 0x90 | condition, 0xC0); // setcc al
+	jit_emit(emitter, 3, 0x0F, 0xB6, 0xC0); // movzx eax, al
+}
+
+// Jumps to the double version of the expression if the condition holds (patched later)
+static void jit_bailout(int condition, jit_emitter_t *emitter) {
+	jit_emit(emitter, 2, 0x0F, 0x80 | condition); // jcc rel32
+	if (emitter->failed)
+		return;
+	int32_t previous = (int32_t) emitter->bailouts;
+	emitter->bailouts = (long) emitter->length;
+	jit_emit(emitter, 4, previous & 0xFF, (previous >> 8) & 0xFF,
+			(previous >> 16) & 0xFF, (previous >> 24) & 0xFF);
+}
+
+// Calls a C function with the arguments in xmm0 to xmm7, like the System V ABI wants
+static void jit_call(const te_expr *expr, int depth, jit_emitter_t *emitter) {
+	int arity = JIT_ARITY(expr->type);
+	for (int i = 0; i < arity; i++) {
+		jit_expression(expr->parameters[i], depth + 1, emitter);
+		jit_push(emitter);
+	}
+	for (int i = arity - 1; i >= 0; i--)
+		jit_pop(emitter, i);
+
+	// The stack has to be 16 byte aligned at the call
+	bool padding = emitter->stack_depth % 2 != 0;
+	if (padding)
+		jit_emit(emitter, 4, 0x48, 0x83, 0xEC, 0x08); // sub rsp, 8
+	jit_emitimmediate(emitter, (uint64_t) (uintptr_t) expr->function);
+	jit_emit(emitter, 2, 0xFF, 0xD0); // call rax
+	if (padding)
+		jit_emit(emitter, 4, 0x48, 0x83, 0xC4, 0x08); // add rsp, 8
+}
+
+#else
+
+jit_t* jit_init() {
+	return NULL;
+}
+
+jit_function jit_compile(const te_expr *expr, jit_t *jit) {
+	return NULL;
+}
+
+void jit_free(jit_t *jit) {
+}
+
+#endif
@@ -32,6 +32,7 @@
 #include <stdbool.h>
 
 #include "../include/listobj.h"
+#include "../include/memstats.h"
 #include "../include/throwable.h"
 
 // Static Prototypes
@@ -44,25 +45,35 @@ static void list_meminspector(int addNum, list_t *subject);
  */
 
 list_t* list_init() {
-	list_t *list = malloc(sizeof(list_t));
-	list->data = (void**) malloc(LIST_MANAGER_ALLOC_SIZE * sizeof(void*));
+	list_t *list = memstats_malloc(sizeof(list_t), MEMSTATS_LISTS);
+	list->data = (void**) memstats_malloc(
+			LIST_MANAGER_ALLOC_SIZE * sizeof(void*), MEMSTATS_LISTS);
+	memstats_capacity(MEMSTATS_LISTS, LIST_MANAGER_ALLOC_SIZE * sizeof(void*),
+			0);
 
 	list->data_length = 0;
 	list->data_allocated_length = LIST_MANAGER_ALLOC_SIZE;
+
+	return list;
 }
 
 static list_t* custom_list_init(int mallocSize) {
-	list_t *list = malloc(sizeof(list_t));
-	list->data = (void**) malloc(mallocSize * sizeof(void*));
+	list_t *list = memstats_malloc(sizeof(list_t), MEMSTATS_LISTS);
+	list->data = (void**) memstats_malloc(mallocSize * sizeof(void*),
+			MEMSTATS_LISTS);
+	memstats_capacity(MEMSTATS_LISTS, mallocSize * sizeof(void*), 0);
 
 	list->data_length = 0;
 	list->data_allocated_length = mallocSize;
+
+	return list;
 }
 
 void list_add(void *item, list_t *list) {
 	list_meminspector(1, list);
 	list->data[list->data_length] = item;
 	list->data_length++;
+	memstats_capacity(MEMSTATS_LISTS, 0, sizeof(void*));
 }
 
 void list_remove(int index, list_t *list) {
@@ -71,6 +82,7 @@ void list_remove(int index, list_t *list) {
 		list->data[i] = list->data[i + 1];
 
 	list->data_length--;
+	memstats_capacity(MEMSTATS_LISTS, 0, -(long) sizeof(void*));
 }
 
 void list_complete_remove(void (*indivfree)(void*), int index, list_t *list) {
@@ -79,6 +91,7 @@ void list_complete_remove(void (*indivfree)(void*), int index, list_t *list) {
 }
 
 void list_clear(list_t *list) {
+	memstats_capacity(MEMSTATS_LISTS, 0, -list->data_length * (long) sizeof(void*));
 	list->data_length = 0;
 }
 
@@ -101,25 +114,32 @@ bool list_contains(void *destComp, bool (*equalsComparator)(void*, void*),
 }
 
 void list_serialize(void (*indiv)(void*, FILE*), FILE *stream, list_t *list) {
-	fwrite(list->data_length, sizeof(int), 1, stream);
+	fwrite(&list->data_length, sizeof(int), 1, stream);
 	for (int i = 0; i < list->data_length; i++)
 		(*indiv)(list->data[i], stream);
 }
 
 list_t* list_deserialize(void* (*indivreverse)(FILE*), FILE *stream) {
 	int arrayLength;
-	fread(&arrayLength, sizeof(int), 1, stream);
-
-	list_t *list = custom_list_init(arrayLength);
-	for (int i = 0; i < arrayLength; i++)
+	if (fread(&arrayLength, sizeof(int), 1, stream) != 1 || arrayLength < 0)
+		arrayLength = 0; // the caller can see the error with ferror() or feof()
+
+	// A damaged length only costs as much memory as there are items in the stream
+	list_t *list = custom_list_init(
+			arrayLength < LIST_MANAGER_ALLOC_SIZE ?
+					arrayLength : LIST_MANAGER_ALLOC_SIZE);
+	for (int i = 0; i < arrayLength && !feof(stream); i++)
 		list_add((*indivreverse)(stream), list);
 
 	return list;
 }
 
 void list_free(list_t *list) {
-	free(list->data);
-	free(list);
+	memstats_capacity(MEMSTATS_LISTS,
+			-list->data_allocated_length * (long) sizeof(void*),
+			-list->data_length * (long) sizeof(void*));
+	memstats_free(list->data, MEMSTATS_LISTS);
+	memstats_free(list, MEMSTATS_LISTS);
 }
 
 void list_complete_free(void (*indivfree)(void*), list_t *list) {
@@ -131,7 +151,10 @@ void list_complete_free(void (*indivfree)(void*), list_t *list) {
 static void list_meminspector(int addNum, list_t *subject) {
 	if (subject->data_length + addNum >= subject->data_allocated_length) {
 		addNum += subject->data_length / 2;
-		void **new_ptr = (void**) realloc(new_ptr, addNum * sizeof(void*));
+		void **new_ptr = (void**) memstats_realloc(subject->data,
+				(subject->data_allocated_length + addNum) * sizeof(void*),
+				MEMSTATS_LISTS);
+		memstats_capacity(MEMSTATS_LISTS, addNum * sizeof(void*), 0);
 		if (new_ptr == NULL)
 			throw_exception(NULL_POINTER_EXCEPTION, -1,
 					"Unable to allocate memory for list with length %d!",
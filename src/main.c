@@ -23,15 +23,471 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/interpreter.h"
+#include "../include/cache.h"
+#include "../include/emitc.h"
+#include "../include/memstats.h"
+#include "../include/server.h"
+#include "../include/threadpool.h"
+#include "../include/throwable.h"
+
+/*
+ * Usage:
+ * freeze [--flush newline|size|exit] [--children N] [--max-depth N] [--cache]
+ *        [--counts file] [--profile file] [--sample file] [--sample-rate N] [--mem-stats]
+ *        [--trace file] [--trace-threshold microseconds] [--no-jit] [--stream] [script.fz]
+ * freeze --emit-c out.c [--max-depth N] [--cache] script.fz
+ * freeze --batch jobs.txt [--threads N] [--children N] [--max-depth N] [--cache]
+ * freeze --serve socket [--flush newline|size|exit] [--children N] [--max-depth N] [--no-jit]
+ *        script.fz [script.fz...]
+ * freeze --prefork N socket [the options of --serve] script.fz [script.fz...]
+ * freeze --call socket "script.fz function args"
+ *
+ * A job list has one script per line, optionally followed by a tab and the file its output
+ * goes to (otherwise the output goes to stdout). Every job gets its own vm_t, and the jobs
+ * are run on a fixed number of threads inside of this one process.
+ *
+ * A server keeps its scripts preprocessed in memory and runs functions from them on request
+ * (see server.h), and --call is the matching client. --prefork does the same with N forked
+ * worker processes, so every request runs isolated in its own process. Their --flush is how
+ * the responses are flushed.
+ *
+ * --children limits how many commands started by spawn can run at once (one per processor by
+ * default). --max-depth limits how deep calls can go. --cache loads scripts from their cache
+ * files (see cache.h) when they are up to date, and saves them there otherwise. --counts
+ * writes how often every instruction of the script ran, which tools/sequences.c turns into a
+ * list of superinstruction candidates. --profile writes where the time of the script went (see
+ * profile.h). --sample writes the same from samples of the call stack (see sampler.h), which
+ * is cheap enough to leave on, at --sample-rate samples per second of CPU time. --mem-stats
+ * writes where the memory went to stderr once the script is done (see memstats.h). --trace
+ * writes a timeline of loading, file I/O, commands and the calls that took at least
+ * --trace-threshold microseconds, which chrome://tracing and Perfetto can open (see trace.h).
+ * --no-jit interprets every expression (see jit.h). --emit-c translates the script into a C
+ * program instead of running it (see emitc.h). --stream runs the top level code line by line
+ * while it is being read, in constant memory (see interpreter_stream()). A script called "-"
+ * is read from stdin, so "generator | freeze --stream -" runs what the generator writes as
+ * soon as it writes it.
+ */
+
+// Settings from the command line that every vm_t gets
+typedef struct {
+	output_flush_policy policy; // 0 for whatever suits the output
+	int max_children; // 0 keeps the default of the vm_t
+	int max_call_depth; // same
+	bool cache; // scripts are loaded from (and saved to) their cache files
+	char *counts_path; // where to write how often every instruction ran (NULL for nowhere)
+	char *profile_path; // where to write the profile of the script (NULL for no profile)
+	char *sample_path; // where to write the samples of the script (NULL for no sampling)
+	int sample_rate; // 0 for SAMPLER_DEFAULT_FREQUENCY
+	bool mem_stats; // the memory of the script is counted and reported
+	char *trace_path; // where to write the timeline of the script (NULL for no tracing)
+	long long trace_threshold; // nanoseconds, -1 for TRACE_DEFAULT_THRESHOLD
+	bool jit; // hot expressions are compiled to machine code
+	char *emit_path; // where to write the script as C instead of running it (NULL to run it)
+	bool stream; // the top level code runs while it is read
+} run_options_t;
+
+typedef struct {
+	char *script_path, *output_path;
+	run_options_t *options;
+	int error_count; // -1 if the job couldn't even be started
+} batch_job_t;
+
+// Static Prototypes
+static int run_script(char *path, run_options_t *options);
+static void run_program(FILE *stream, char *path, vm_t *vm,
+		run_options_t *options);
+static void run_apply(vm_t *vm, run_options_t *options);
+static bool run_profile(char *path, bool sampled, vm_t *vm);
+static bool run_emit(FILE *stream, char *path, vm_t *vm,
+		run_options_t *options);
+static int run_batch(char *jobListPath, int threadCount,
+		run_options_t *options);
+static int run_serve(char *socketPath, int workerCount, list_t *scriptPaths,
+		run_options_t *options);
+static void batch_runjob(void *job);
+static list_t* batch_readjobs(FILE *stream);
 
 int main(int argc, char **argv) {
-	if (argc > 1) {
-		// get the file
+	// File for Testing purposes
+	char *scriptPath = "test/Test #1.fz";
+	char *batchPath = NULL;
+	int threadCount = 0;
+	char *servePath = NULL, *callPath = NULL, *callRequest = NULL;
+	int workerCount = 0;
+	run_options_t options = { 0, 0, 0, false, NULL, NULL, NULL, 0, false,
+			NULL, -1, true, NULL, false };
+	list_t *scriptPaths = list_init();
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+			batchPath = argv[++i];
+		} else if (strcmp(argv[i], "--flush") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "newline") == 0)
+				options.policy = OUTPUT_FLUSH_NEWLINE;
+			else if (strcmp(argv[i], "size") == 0)
+				options.policy = OUTPUT_FLUSH_SIZE;
+			else if (strcmp(argv[i], "exit") == 0)
+				options.policy = OUTPUT_FLUSH_EXIT;
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threadCount = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--children") == 0 && i + 1 < argc) {
+			options.max_children = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--max-depth") == 0 && i + 1 < argc) {
+			options.max_call_depth = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--counts") == 0 && i + 1 < argc) {
+			options.counts_path = argv[++i];
+		} else if (strcmp(argv[i], "--emit-c") == 0 && i + 1 < argc) {
+			options.emit_path = argv[++i];
+		} else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			options.profile_path = argv[++i];
+		} else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+			options.sample_path = argv[++i];
+		} else if (strcmp(argv[i], "--sample-rate") == 0 && i + 1 < argc) {
+			options.sample_rate = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			options.trace_path = argv[++i];
+		} else if (strcmp(argv[i], "--trace-threshold") == 0 && i + 1 < argc) {
+			options.trace_threshold = atoll(argv[++i]) * 1000;
+		} else if (strcmp(argv[i], "--mem-stats") == 0) {
+			options.mem_stats = true;
+			memstats_enable();
+		} else if (strcmp(argv[i], "--no-jit") == 0) {
+			options.jit = false;
+		} else if (strcmp(argv[i], "--cache") == 0) {
+			options.cache = true;
+		} else if (strcmp(argv[i], "--stream") == 0) {
+			options.stream = true;
+		} else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+			servePath = argv[++i];
+		} else if (strcmp(argv[i], "--prefork") == 0 && i + 2 < argc) {
+			workerCount = atoi(argv[++i]);
+			servePath = argv[++i];
+		} else if (strcmp(argv[i], "--call") == 0 && i + 2 < argc) {
+			callPath = argv[++i];
+			callRequest = argv[++i];
+		} else if (strncmp(argv[i], "--", 2) == 0) {
+			fprintf(stderr, "Usage: %s [--flush newline|size|exit] [--children N]"
+					" [--max-depth N] [--cache] [--counts file]"
+					" [--profile file] [--sample file] [--sample-rate N] [--mem-stats]"
+					" [--trace file] [--trace-threshold microseconds] [--no-jit]"
+					" [--stream] [script.fz]"
+					" | --emit-c out.c script.fz"
+					" | --batch jobs.txt [--threads N]"
+					" | --serve socket [--flush ...] [--children N] [--max-depth N]"
+					" [--no-jit] script.fz..."
+					" | --prefork N socket [the options of --serve] script.fz..."
+					" | --call socket request\n",
+					argv[0]);
+			list_free(scriptPaths);
+			return EXIT_FAILURE;
+		} else {
+			scriptPath = argv[i];
+			list_add(argv[i], scriptPaths);
+		}
 	}
 
-	// File for Testing purposes
-	char *testFile = "test/test #1.fz";
+	int status;
+	if (batchPath != NULL)
+		status = run_batch(batchPath, threadCount, &options);
+	else if (servePath != NULL)
+		status = run_serve(servePath, workerCount, scriptPaths, &options);
+	else if (callPath != NULL)
+		status = server_call(callPath, callRequest) == 0 ?
+						EXIT_SUCCESS : EXIT_FAILURE;
+	else
+		status = run_script(scriptPath, &options);
+
+	list_free(scriptPaths);
+	return status;
+}
+
+static int run_script(char *path, run_options_t *options) {
+	FILE *stream = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+	if (stream == NULL) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to open %s", path);
+		return EXIT_FAILURE;
+	}
+
+	vm_t *vm = vm_init();
+	if (options->emit_path != NULL) {
+		bool emitted = run_emit(stream, path, vm, options);
+		vm_free(vm);
+		fclose(stream);
+		return emitted ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (options->policy != 0)
+		vm->output->policy = options->policy;
+	vm->count_instructions = options->counts_path != NULL;
+	if (options->profile_path != NULL)
+		vm->profile = profile_init();
+	if (options->sample_path != NULL) {
+		vm->sampler = sampler_init(options->sample_rate);
+		if (!sampler_start(vm->sampler))
+			throw_exception(ERRNO_EXCEPTION, -1, "Unable to start the sampler");
+	}
+	if (options->trace_path != NULL)
+		vm->trace = trace_init(TRACE_DEFAULT_CAPACITY,
+				options->trace_threshold >= 0 ?
+						options->trace_threshold : TRACE_DEFAULT_THRESHOLD);
+	run_program(stream, path, vm, options);
+	int errorCount = vm->error_count;
+	if (options->profile_path != NULL && !run_profile(options->profile_path, false, vm))
+		errorCount++;
+	if (options->sample_path != NULL) {
+		sampler_stop(vm->sampler);
+		if (!run_profile(options->sample_path, true, vm))
+			errorCount++;
+	}
+	if (options->trace_path != NULL) {
+		FILE *trace = fopen(options->trace_path, "w");
+		if (trace == NULL) {
+			throw_exception(ERRNO_EXCEPTION, -1, "Unable to open %s",
+					options->trace_path);
+			errorCount++;
+		} else {
+			trace_write(trace, vm->trace);
+			fclose(trace);
+		}
+	}
+
+	if (options->counts_path != NULL) {
+		FILE *counts = fopen(options->counts_path, "w");
+		if (counts == NULL) {
+			throw_exception(ERRNO_EXCEPTION, -1, "Unable to open %s",
+					options->counts_path);
+			errorCount++;
+		} else {
+			interpreter_writecounts(counts, vm);
+			fclose(counts);
+		}
+	}
+	// Before the program is freed, so the unused capacity of its strings and lists shows
+	if (options->mem_stats)
+		memstats_report(stderr);
+	vm_free(vm);
+	fclose(stream);
+
+	return errorCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Applies the options to a new vm_t, then loads and runs the script
+static void run_program(FILE *stream, char *path, vm_t *vm,
+		run_options_t *options) {
+	run_apply(vm, options);
+	if (options->stream) {
+		interpreter_stream(stream, vm); // nothing is loaded ahead of time, cached or not
+		return;
+	}
+	if (!options->cache) {
+		interpreter_ignition(stream, vm);
+		return;
+	}
+	long long started = vm->trace != NULL ? trace_now() : 0;
+	cache_preprocess(stream, path, vm);
+	if (vm->trace != NULL)
+		trace_span(TRACE_PHASE, "load", path, -1, started, vm->trace);
+	if (vm->error_count == 0)
+		interpreter_run(vm);
+}
+
+static void run_apply(vm_t *vm, run_options_t *options) {
+	if (options->max_children > 0)
+		vm->max_children = options->max_children;
+	if (options->max_call_depth > 0)
+		vm->max_call_depth = options->max_call_depth;
+	vm->jit_enabled = options->jit;
+}
+
+// Writes the report of the profile (or of the samples), and the folded call stacks next to it
+static bool run_profile(char *path, bool sampled, vm_t *vm) {
+	string_t *foldedPath = string_copyvalueof(path);
+	string_append(foldedPath, PROFILE_FOLDED_EXTENSION);
+	FILE *report = fopen(path, "w");
+	FILE *folded = fopen(foldedPath->text, "w");
+	bool written = report != NULL && folded != NULL;
+	if (written && sampled)
+		sampler_report(report, folded, vm->function_list, vm->sampler);
+	else if (written)
+		profile_report(report, folded, vm->function_list, vm->profile);
+	else
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to open %s",
+				report == NULL ? path : foldedPath->text);
 
+	if (report != NULL)
+		fclose(report);
+	if (folded != NULL)
+		fclose(folded);
+	string_free(foldedPath);
+	return written;
+}
+
+// Loads the script like run_program() does, but writes it out as C instead of running it
+static bool run_emit(FILE *stream, char *path, vm_t *vm,
+		run_options_t *options) {
+	run_apply(vm, options);
+	if (options->cache)
+		cache_preprocess(stream, path, vm);
+	else
+		interpreter_preprocessfile(stream, vm);
+	if (vm->error_count > 0)
+		return false;
+
+	FILE *out = fopen(options->emit_path, "w");
+	if (out == NULL) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to open %s",
+				options->emit_path);
+		return false;
+	}
+	bool emitted = emitc_program(out, path, vm);
+	if (fclose(out) != 0) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to write %s",
+				options->emit_path);
+		emitted = false;
+	}
+	if (!emitted)
+		remove(options->emit_path); // half of a program is no use to anyone
+	return emitted;
+}
+
+static int run_batch(char *jobListPath, int threadCount,
+		run_options_t *options) {
+	// These write one file about one script, which every job would be writing at once
+	if (options->counts_path != NULL || options->profile_path != NULL
+			|| options->sample_path != NULL || options->trace_path != NULL
+			|| options->emit_path != NULL) {
+		fprintf(stderr, "--batch doesn't go together with --counts, --profile, --sample,"
+				" --trace or --emit-c\n");
+		return EXIT_FAILURE;
+	}
+
+	FILE *jobList = fopen(jobListPath, "r");
+	if (jobList == NULL) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to open %s", jobListPath);
+		return EXIT_FAILURE;
+	}
+	list_t *jobs = batch_readjobs(jobList);
+	fclose(jobList);
+
+	threadpool_t *pool = threadpool_init(threadCount);
+	for (int i = 0; i < jobs->data_length; i++) {
+		((batch_job_t*) jobs->data[i])->options = options;
+		threadpool_submit(&batch_runjob, jobs->data[i], pool);
+	}
+	threadpool_free(pool);
+	if (options->mem_stats)
+		memstats_report(stderr);
+
+	int failedCount = 0;
+	for (int i = 0; i < jobs->data_length; i++) {
+		batch_job_t *job = jobs->data[i];
+		if (job->error_count != 0) {
+			fprintf(stderr, "Job #%d (%s) failed\n", i + 1, job->script_path);
+			failedCount++;
+		}
+		free(job->script_path);
+		free(job);
+	}
+	list_free(jobs);
+
+	return failedCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Loads the scripts of --serve (or --prefork, with workers) and applies the options to them
+static int run_serve(char *socketPath, int workerCount, list_t *scriptPaths,
+		run_options_t *options) {
+	// These are about a single run of a script, which a server doesn't have
+	if (options->cache || options->counts_path != NULL
+			|| options->profile_path != NULL || options->sample_path != NULL
+			|| options->trace_path != NULL || options->mem_stats
+			|| options->emit_path != NULL || options->stream) {
+		fprintf(stderr, "--serve and --prefork only go together with --flush,"
+				" --children, --max-depth and --no-jit\n");
+		return EXIT_FAILURE;
+	}
+
+	list_t *scripts = server_loadscripts((char**) scriptPaths->data,
+			scriptPaths->data_length);
+	if (scripts == NULL)
+		return EXIT_FAILURE;
+	for (int i = 0; i < scripts->data_length; i++) {
+		vm_t *vm = ((server_script_t*) scripts->data[i])->vm;
+		if (options->policy != 0)
+			vm->output->policy = options->policy;
+		run_apply(vm, options);
+	}
+
+	if (workerCount > 0)
+		return server_prefork(socketPath, scripts, workerCount,
+				options->policy);
+	return server_run(socketPath, scripts, options->policy);
+}
+
+static void batch_runjob(void *arg) {
+	batch_job_t *job = arg;
+	job->error_count = -1;
+
+	FILE *stream = fopen(job->script_path, "r");
+	if (stream == NULL) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to open %s",
+				job->script_path);
+		return;
+	}
+	int output = STDOUT_FILENO;
+	if (job->output_path != NULL
+			&& (output = open(job->output_path,
+			O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to open %s",
+				job->output_path);
+		fclose(stream);
+		return;
+	}
+
+	vm_t *vm = vm_init();
+	output_free(vm->output);
+	vm->output = output_init(output,
+			job->options->policy != 0 ?
+					job->options->policy : output_defaultpolicy(output));
+	run_program(stream, job->script_path, vm, job->options);
+	job->error_count = vm->error_count;
+	vm_free(vm);
+
+	if (output != STDOUT_FILENO)
+		close(output);
+	fclose(stream);
+}
+
+static list_t* batch_readjobs(FILE *stream) {
+	list_t *jobs = list_init();
+
+	char *line = NULL;
+	size_t capacity = 0;
+	ssize_t length;
+	while ((length = getline(&line, &capacity, stream)) != -1) {
+		while (length > 0
+				&& (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			line[--length] = '\0';
+		if (length == 0 || line[0] == '#')
+			continue;
+
+		batch_job_t *job = malloc(sizeof(batch_job_t));
+		// Both paths share one allocation, split at the tab
+		job->script_path = strdup(line);
+		job->output_path = NULL;
+		char *tab = strchr(job->script_path, '\t');
+		if (tab != NULL) {
+			*tab = '\0';
+			job->output_path = tab + 1;
+		}
+		job->error_count = 0;
+		list_add(job, jobs);
+	}
+	free(line);
 
-	return EXIT_SUCCESS;
+	return jobs;
 }
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * mapobj.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "../include/mapobj.h"
+#include "../include/stringobj.h"
+
+#define MAP_FNV_OFFSET 2166136261u
+#define MAP_FNV_PRIME 16777619u
+
+// Static Prototypes
+static map_entry_t* map_find(string_t *key, unsigned int hash, map_t *map);
+static void map_meminspector(map_t *subject);
+
+map_t* map_init() {
+	map_t *map = malloc(sizeof(map_t));
+	map->entries = calloc(MAP_MANAGER_ALLOC_SIZE, sizeof(map_entry_t));
+
+	map->data_length = 0;
+	map->data_allocated_length = MAP_MANAGER_ALLOC_SIZE;
+
+	return map;
+}
+
+bool map_put(string_t *key, void *value, map_t *map) {
+	map_meminspector(map);
+
+	unsigned int hash = map_hash(key->text, key->text_length);
+	map_entry_t *entry = map_find(key, hash, map);
+	if (entry->key != NULL)
+		return false;
+
+	entry->key = key;
+	entry->hash = hash;
+	entry->value = value;
+	map->data_length++;
+	return true;
+}
+
+void* map_get(string_t *key, map_t *map) {
+	map_entry_t *entry = map_find(key,
+			map_hash(key->text, key->text_length), map);
+	return entry->value; // empty entries have a NULL value
+}
+
+void map_clear(map_t *map) {
+	memset(map->entries, 0, map->data_allocated_length * sizeof(map_entry_t));
+	map->data_length = 0;
+}
+
+void map_free(map_t *map) {
+	free(map->entries);
+	free(map);
+}
+
+unsigned int map_hash(char *text, int length) {
+	unsigned int hash = MAP_FNV_OFFSET;
+	for (int i = 0; i < length; i++) {
+		hash ^= (unsigned char) text[i];
+		hash *= MAP_FNV_PRIME;
+	}
+	return hash;
+}
+
+// Returns the entry of the key, or the empty entry where it would go
+static map_entry_t* map_find(string_t *key, unsigned int hash, map_t *map) {
+	unsigned int mask = map->data_allocated_length - 1;
+	for (unsigned int i = hash & mask;; i = (i + 1) & mask) {
+		map_entry_t *entry = &map->entries[i];
+		if (entry->key == NULL
+				|| (entry->hash == hash && string_equals_s(entry->key, key)))
+			return entry;
+	}
+}
+
+// Keeps the map at most half full, so that probing stays short
+static void map_meminspector(map_t *subject) {
+	if ((subject->data_length + 1) * 2 <= subject->data_allocated_length)
+		return;
+
+	map_entry_t *oldEntries = subject->entries;
+	int oldLength = subject->data_allocated_length;
+	subject->data_allocated_length *= 2;
+	subject->entries = calloc(subject->data_allocated_length,
+			sizeof(map_entry_t));
+
+	for (int i = 0; i < oldLength; i++) {
+		if (oldEntries[i].key == NULL)
+			continue;
+		*map_find(oldEntries[i].key, oldEntries[i].hash, subject) =
+				oldEntries[i];
+	}
+	free(oldEntries);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * memstats.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "../include/memstats.h"
+
+typedef struct {
+	atomic_long live, peak; // in bytes
+	atomic_long allocations, frees;
+	atomic_long capacity, used; // of the strings or lists, in bytes
+} memstats_counter_t;
+
+bool memstats_enabled = false;
+
+static memstats_counter_t memstats_counters[MEMSTATS_CATEGORY_COUNT];
+static atomic_long memstats_live, memstats_peak; // of every category together
+
+static const char *memstats_names[MEMSTATS_CATEGORY_COUNT] = { "strings",
+		"lists", "instructions", "expressions", "variables", "I/O buffers" };
+
+// Static Prototypes
+static void memstats_raisepeak(atomic_long *peak, long live);
+
+void memstats_enable(void) {
+	memstats_enabled = true;
+}
+
+void memstats_count(memstats_category category, long bytes, int allocations) {
+	memstats_counter_t *counter = &memstats_counters[category];
+	long live = atomic_fetch_add_explicit(&counter->live, bytes,
+			memory_order_relaxed) + bytes;
+	long total = atomic_fetch_add_explicit(&memstats_live, bytes,
+			memory_order_relaxed) + bytes;
+	if (bytes > 0) {
+		memstats_raisepeak(&counter->peak, live);
+		memstats_raisepeak(&memstats_peak, total);
+	}
+	if (allocations > 0)
+		atomic_fetch_add_explicit(&counter->allocations, allocations,
+				memory_order_relaxed);
+	else if (allocations < 0)
+		atomic_fetch_add_explicit(&counter->frees, -allocations,
+				memory_order_relaxed);
+}
+
+void memstats_countcapacity(memstats_category category, long capacity,
+		long used) {
+	memstats_counter_t *counter = &memstats_counters[category];
+	if (capacity != 0)
+		atomic_fetch_add_explicit(&counter->capacity, capacity,
+				memory_order_relaxed);
+	if (used != 0)
+		atomic_fetch_add_explicit(&counter->used, used, memory_order_relaxed);
+}
+
+void memstats_report(FILE *stream) {
+	fprintf(stream, "%-14s %14s %14s %12s %12s\n", "memory", "live bytes",
+			"peak bytes", "allocations", "frees");
+	for (int i = 0; i < MEMSTATS_CATEGORY_COUNT; i++) {
+		memstats_counter_t *counter = &memstats_counters[i];
+		fprintf(stream, "%-14s %14ld %14ld %12ld %12ld\n", memstats_names[i],
+				atomic_load(&counter->live), atomic_load(&counter->peak),
+				atomic_load(&counter->allocations), atomic_load(&counter->frees));
+	}
+	fprintf(stream, "%-14s %14ld %14ld\n", "total", atomic_load(&memstats_live),
+			atomic_load(&memstats_peak));
+
+	// What the growth of strings and lists has allocated, but nothing uses yet
+	fprintf(stream, "\n%-14s %14s %14s %14s\n", "capacity", "bytes", "used",
+			"unused");
+	for (int i = MEMSTATS_STRINGS; i <= MEMSTATS_LISTS; i++) {
+		long capacity = atomic_load(&memstats_counters[i].capacity);
+		long used = atomic_load(&memstats_counters[i].used);
+		fprintf(stream, "%-14s %14ld %14ld %14ld (%.1f%%)\n", memstats_names[i],
+				capacity, used, capacity - used,
+				capacity > 0 ? 100.0 * (capacity - used) / capacity : 0.0);
+	}
+}
+
+static void memstats_raisepeak(atomic_long *peak, long live) {
+	long highest = atomic_load_explicit(peak, memory_order_relaxed);
+	while (live > highest
+			&& !atomic_compare_exchange_weak_explicit(peak, &highest, live,
+					memory_order_relaxed, memory_order_relaxed))
+		;
+}
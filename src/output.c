@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * output.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "../include/output.h"
+#include "../include/memstats.h"
+#include "../include/throwable.h"
+
+// Longest thing "%.15g" can print, plus the null character
+#define OUTPUT_NUMBER_SIZE 32
+
+// Static Prototypes
+static void output_writepieces(output_t *out);
+static void output_reserve(output_t *out, int length);
+static void output_cutpiece(output_t *out);
+static void output_addpiece(output_t *out, char *text, int length);
+
+output_t* output_init(int fd, output_flush_policy policy) {
+	output_t *out = memstats_malloc(sizeof(output_t), MEMSTATS_IO);
+
+	out->fd = fd;
+	out->policy = policy;
+
+	out->buffer = NULL;
+	out->buffer_length = 0;
+	out->buffer_allocated_length = 0;
+	out->buffer_written = 0;
+
+	out->piece_count = 0;
+	out->has_newline = false;
+	out->error = 0;
+
+	return out;
+}
+
+output_flush_policy output_defaultpolicy(int fd) {
+	return isatty(fd) ? OUTPUT_FLUSH_NEWLINE : OUTPUT_FLUSH_SIZE;
+}
+
+void output_append(output_t *out, char *text, int length) {
+	if (out->policy == OUTPUT_FLUSH_NEWLINE && !out->has_newline)
+		out->has_newline = memchr(text, '\n', length) != NULL;
+
+	output_reserve(out, length);
+	// Still too big for the buffer (which is empty now), so it's written right away
+	if (out->buffer_length + length > out->buffer_allocated_length) {
+		output_addpiece(out, text, length);
+		output_flush(out);
+		return;
+	}
+	memcpy(out->buffer + out->buffer_length, text, length);
+	out->buffer_length += length;
+}
+
+void output_appendstatic(output_t *out, char *text, int length) {
+	if (length < OUTPUT_DIRECT_SIZE || out->policy == OUTPUT_FLUSH_EXIT) {
+		output_append(out, text, length);
+		return;
+	}
+
+	if (out->policy == OUTPUT_FLUSH_NEWLINE && !out->has_newline)
+		out->has_newline = memchr(text, '\n', length) != NULL;
+	output_cutpiece(out);
+	output_addpiece(out, text, length);
+}
+
+void output_appendchar(output_t *out, char letter) {
+	output_reserve(out, 1);
+	out->buffer[out->buffer_length++] = letter;
+	if (letter == '\n')
+		out->has_newline = true;
+}
+
+void output_appenddouble(output_t *out, double number) {
+	output_reserve(out, OUTPUT_NUMBER_SIZE);
+	char *dest = out->buffer + out->buffer_length;
+
+	// Whole numbers (most of what gets printed) don't need snprintf()
+	if (number == floor(number) && fabs(number) < 1e15) {
+		long long whole = (long long) number;
+		char digits[OUTPUT_NUMBER_SIZE];
+		int digitCount = 0;
+		bool negative = whole < 0 || (whole == 0 && signbit(number));
+		unsigned long long remaining = whole < 0 ? -whole : whole;
+		do {
+			digits[digitCount++] = '0' + remaining % 10;
+			remaining /= 10;
+		} while (remaining > 0);
+
+		int length = 0;
+		if (negative)
+			dest[length++] = '-';
+		while (digitCount > 0)
+			dest[length++] = digits[--digitCount];
+		out->buffer_length += length;
+		return;
+	}
+
+	out->buffer_length += snprintf(dest, OUTPUT_NUMBER_SIZE, "%.15g", number);
+}
+
+void output_endwrite(output_t *out) {
+	if (out->policy == OUTPUT_FLUSH_NEWLINE && out->has_newline)
+		output_flush(out);
+}
+
+bool output_flush(output_t *out) {
+	output_writepieces(out);
+	output_cutpiece(out);
+	output_writepieces(out);
+
+	out->buffer_length = 0;
+	out->buffer_written = 0;
+	out->has_newline = false;
+	return out->error == 0;
+}
+
+void output_free(output_t *out) {
+	output_flush(out);
+	memstats_free(out->buffer, MEMSTATS_IO);
+	memstats_free(out, MEMSTATS_IO);
+}
+
+static void output_writepieces(output_t *out) {
+	struct iovec *pieces = out->pieces;
+	int pieceCount = out->piece_count;
+	while (pieceCount > 0 && out->error == 0) {
+		ssize_t writeCount = writev(out->fd, pieces, pieceCount);
+		if (writeCount == -1) {
+			if (errno == EINTR)
+				continue;
+			out->error = errno;
+			throw_exception(ERRNO_EXCEPTION, -1, "Unable to write the output");
+			break;
+		}
+
+		// Partly written, so the pieces that are done are skipped
+		while (pieceCount > 0 && (size_t) writeCount >= pieces->iov_len) {
+			writeCount -= pieces->iov_len;
+			pieces++;
+			pieceCount--;
+		}
+		if (pieceCount > 0) {
+			pieces->iov_base = (char*) pieces->iov_base + writeCount;
+			pieces->iov_len -= writeCount;
+		}
+	}
+	out->piece_count = 0;
+}
+
+/**
+ * Makes sure that length more bytes fit into the buffer, by flushing (or by growing the buffer,
+ * if everything is only written at the end).
+ */
+static void output_reserve(output_t *out, int length) {
+	if (out->buffer == NULL) {
+		out->buffer_allocated_length = OUTPUT_BUFFER_SIZE;
+		out->buffer = memstats_malloc(out->buffer_allocated_length, MEMSTATS_IO);
+	}
+	if (out->buffer_length + length <= out->buffer_allocated_length)
+		return;
+
+	if (out->policy == OUTPUT_FLUSH_EXIT) {
+		// Nothing in the buffer is referenced yet, since every piece is cut when it's written
+		while (out->buffer_length + length > out->buffer_allocated_length)
+			out->buffer_allocated_length *= 2;
+		out->buffer = memstats_realloc(out->buffer, out->buffer_allocated_length,
+				MEMSTATS_IO);
+	} else {
+		output_flush(out);
+	}
+}
+
+// Turns what has been added to the buffer since the last piece into a piece of its own
+static void output_cutpiece(output_t *out) {
+	if (out->buffer_length == out->buffer_written)
+		return;
+	output_addpiece(out, out->buffer + out->buffer_written,
+			out->buffer_length - out->buffer_written);
+	out->buffer_written = out->buffer_length;
+}
+
+static void output_addpiece(output_t *out, char *text, int length) {
+	// The part of the buffer that hasn't been cut yet stays where it is
+	if (out->piece_count == OUTPUT_MAX_PIECES)
+		output_writepieces(out);
+	out->pieces[out->piece_count].iov_base = text;
+	out->pieces[out->piece_count].iov_len = length;
+	out->piece_count++;
+}
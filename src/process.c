@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * process.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#define _GNU_SOURCE // for pipe2()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "../include/process.h"
+#include "../include/stringobj.h"
+#include "../include/listobj.h"
+
+// Without pidfds, finished children are looked for this often (in milliseconds)
+#define PROCESS_POLL_INTERVAL 10
+#define PROCESS_READ_SIZE 65536
+
+extern char **environ;
+
+// Static Prototypes
+static char** process_splitcommand(char *command);
+static bool process_readoutput(process_t *proc);
+static bool process_reap(process_t *proc, bool block);
+
+process_t* process_spawn(char *command, bool capture, int stdoutFd) {
+	int pipeFds[2] = { -1, -1 };
+	// Other children shouldn't inherit the pipe, or it would never be closed. That includes the
+	// ones other threads (of --batch) start in the meantime, so the pipe is close-on-exec
+	// from the start.
+	if (capture && pipe2(pipeFds, O_CLOEXEC) == -1)
+		return NULL;
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	if (capture)
+		posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDOUT_FILENO);
+	else if (stdoutFd != STDOUT_FILENO)
+		posix_spawn_file_actions_adddup2(&actions, stdoutFd, STDOUT_FILENO);
+
+	// Simple commands are run directly, which saves starting a shell every time
+	char *shellArgs[] = { "sh", "-c", command, NULL };
+	char **args = shellArgs;
+	if (strpbrk(command, PROCESS_SHELL_CHARACTERS) == NULL)
+		args = process_splitcommand(command);
+
+	pid_t pid;
+	int spawnError = ENOENT;
+	if (args != shellArgs && args[0] != NULL)
+		spawnError = posix_spawnp(&pid, args[0], &actions, NULL, args,
+				environ);
+	// Shell builtins (like exit) and commands that don't exist are left to the shell, which
+	// runs the builtin or exits with 127, just like system() does
+	if (args == shellArgs || spawnError == ENOENT)
+		spawnError = posix_spawn(&pid, PROCESS_SHELL, &actions, NULL,
+				shellArgs, environ);
+
+	posix_spawn_file_actions_destroy(&actions);
+	if (args != shellArgs) {
+		for (int i = 0; args[i] != NULL; i++)
+			free(args[i]);
+		free(args);
+	}
+	if (capture)
+		close(pipeFds[1]);
+	if (spawnError != 0) {
+		if (capture)
+			close(pipeFds[0]);
+		errno = spawnError;
+		return NULL;
+	}
+
+	process_t *proc = malloc(sizeof(process_t));
+	proc->pid = pid;
+	proc->command = strdup(command);
+	proc->pidfd = syscall(SYS_pidfd_open, pid, 0);
+	proc->output_fd = pipeFds[0];
+	proc->output = capture ? string_init() : NULL;
+	proc->status = -1;
+	proc->done = false;
+	proc->status_context = NULL;
+	proc->output_context = NULL;
+	proc->line_num = -1;
+	proc->started = 0;
+	proc->finished = 0;
+	return proc;
+}
+
+void process_waitany(list_t *processes) {
+	int count = processes->data_length;
+	struct pollfd *pollFds = malloc((2 * count + 1) * sizeof(struct pollfd));
+
+	while (true) {
+		int pollCount = 0;
+		bool anyRunning = false, missingPidfd = false;
+		for (int i = 0; i < count; i++) {
+			process_t *proc = processes->data[i];
+			if (proc->done)
+				continue;
+			anyRunning = true;
+
+			if (proc->output_fd != -1) {
+				pollFds[pollCount].fd = proc->output_fd;
+				pollFds[pollCount++].events = POLLIN;
+			}
+			if (proc->pidfd != -1) {
+				pollFds[pollCount].fd = proc->pidfd;
+				pollFds[pollCount++].events = POLLIN;
+			} else {
+				missingPidfd = true;
+			}
+		}
+		if (!anyRunning)
+			break;
+
+		if (poll(pollFds, pollCount, missingPidfd ? PROCESS_POLL_INTERVAL : -1)
+				== -1 && errno != EINTR)
+			break;
+
+		// Output is read before looking for exited children, so none of it gets lost
+		bool anyDone = false;
+		for (int i = 0; i < count; i++) {
+			process_t *proc = processes->data[i];
+			if (proc->done)
+				continue;
+			if (proc->output_fd != -1)
+				process_readoutput(proc);
+			if (process_reap(proc, false))
+				anyDone = true;
+		}
+		if (anyDone)
+			break;
+	}
+
+	free(pollFds);
+}
+
+int process_runningcount(list_t *processes) {
+	int count = 0;
+	for (int i = 0; i < processes->data_length; i++)
+		if (!((process_t*) processes->data[i])->done)
+			count++;
+	return count;
+}
+
+void process_free(void *process) {
+	process_t *proc = process;
+	if (!proc->done) {
+		kill(proc->pid, SIGKILL);
+		process_reap(proc, true);
+	}
+	if (proc->output != NULL)
+		string_free(proc->output);
+	free(proc->command);
+	free(proc);
+}
+
+/**
+ * Splits a command without any shell characters into arguments at the spaces.
+ */
+static char** process_splitcommand(char *command) {
+	list_t *args = list_init();
+	char *current = command;
+	while (*current != '\0') {
+		while (*current == ' ' || *current == '\t')
+			current++;
+		if (*current == '\0')
+			break;
+		char *end = current + strcspn(current, " \t");
+		list_add(strndup(current, end - current), args);
+		current = end;
+	}
+	list_add(NULL, args);
+
+	// The list's array becomes the argv array
+	char **argv = (char**) args->data;
+	free(args);
+	return argv;
+}
+
+// Reads whatever is there right now, returns false once the child has closed its end
+static bool process_readoutput(process_t *proc) {
+	char buffer[PROCESS_READ_SIZE];
+	while (true) {
+		struct pollfd pollFd = { proc->output_fd, POLLIN, 0 };
+		if (poll(&pollFd, 1, 0) <= 0)
+			return true;
+
+		ssize_t readCount = read(proc->output_fd, buffer, sizeof(buffer));
+		if (readCount == -1 && errno == EINTR)
+			continue;
+		if (readCount <= 0) {
+			close(proc->output_fd);
+			proc->output_fd = -1;
+			return false;
+		}
+		string_appendn(proc->output, buffer, readCount);
+	}
+}
+
+/**
+ * Collects the exit status if the child has exited. A finished child might still have output
+ * in the pipe (or a grandchild might hold it open), so the pipe is read until it's closed.
+ */
+static bool process_reap(process_t *proc, bool block) {
+	int status;
+	pid_t result;
+	do {
+		result = waitpid(proc->pid, &status, block ? 0 : WNOHANG);
+	} while (result == -1 && errno == EINTR);
+	if (result == 0)
+		return false;
+
+	if (proc->started != 0) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		proc->finished = now.tv_sec * 1000000000LL + now.tv_nsec;
+	}
+	if (result == -1)
+		proc->status = -1;
+	else if (WIFEXITED(status))
+		proc->status = WEXITSTATUS(status);
+	else
+		proc->status = 128 + WTERMSIG(status);
+
+	if (proc->output_fd != -1) {
+		// The child is gone, so blocking reads only wait for whoever else holds the pipe
+		char buffer[PROCESS_READ_SIZE];
+		ssize_t readCount;
+		while ((readCount = read(proc->output_fd, buffer, sizeof(buffer))) != 0) {
+			if (readCount == -1) {
+				if (errno == EINTR)
+					continue;
+				break;
+			}
+			string_appendn(proc->output, buffer, readCount);
+		}
+		close(proc->output_fd);
+		proc->output_fd = -1;
+	}
+	if (proc->pidfd != -1) {
+		close(proc->pidfd);
+		proc->pidfd = -1;
+	}
+	proc->done = true;
+	return true;
+}
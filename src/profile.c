@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * profile.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/profile.h"
+#include "../include/interpreter.h"
+#include "../include/listobj.h"
+#include "../include/memstats.h"
+
+#define PROFILE_NANOSECONDS_PER_MILLISECOND 1e6
+
+// An instruction in the report, with the function it is in
+typedef struct {
+	function_t *funct;
+	parsed_instruction_t *instr;
+} profile_line_t;
+
+// Static Prototypes
+static profile_node_t* profile_node(profile_function_t *function,
+		profile_node_t *parent, profile_t *profile);
+static profile_function_t* profile_function(function_t *funct,
+		profile_t *profile);
+static void profile_walk(FILE *folded, list_t *functions, profile_t *profile);
+static char* profile_name(profile_function_t *function, list_t *functions);
+static double profile_percent(long long part, long long whole);
+static int profile_comparelines(const void *a, const void *b);
+static int profile_comparefunctions(const void *a, const void *b);
+
+profile_t* profile_init() {
+	profile_t *profile = malloc(sizeof(profile_t));
+	profile->nodes = list_init();
+	profile->functions = list_init();
+	profile->root = profile_node(profile_function(NULL, profile), NULL,
+			profile);
+	profile->root->calls = 1;
+	profile->current = profile->root;
+	profile->started = profile_now();
+	return profile;
+}
+
+long long profile_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+void profile_enter(function_t *funct, bool tail, profile_t *profile) {
+	profile_node_t *parent = profile->current;
+	if (tail && parent->parent != NULL)
+		parent = parent->parent;
+
+	profile_node_t *node = NULL;
+	for (int i = 0; i < parent->children->data_length && node == NULL; i++)
+		if (((profile_node_t*) parent->children->data[i])->function->funct
+				== funct)
+			node = parent->children->data[i];
+	if (node == NULL)
+		node = profile_node(profile_function(funct, profile), parent, profile);
+	node->calls++;
+	profile->current = node;
+}
+
+void profile_leave(profile_t *profile) {
+	if (profile->current->parent != NULL)
+		profile->current = profile->current->parent;
+}
+
+void profile_report(FILE *report, FILE *folded, list_t *functions,
+		profile_t *profile) {
+	profile_walk(folded, functions, profile);
+	long long measured = profile->root->total_nanoseconds;
+
+	int lineCount = 0;
+	for (int i = 0; i < functions->data_length; i++)
+		lineCount += ((function_t*) functions->data[i])->parsed_instructions->data_length;
+	profile_line_t *lines = malloc((lineCount + 1) * sizeof(profile_line_t));
+	int ranCount = 0;
+	for (int i = 0; i < functions->data_length; i++) {
+		function_t *funct = functions->data[i];
+		for (int j = 0; j < funct->parsed_instructions->data_length; j++) {
+			parsed_instruction_t *instr = funct->parsed_instructions->data[j];
+			if (instr->run_count > 0)
+				lines[ranCount++] = (profile_line_t ) { funct, instr };
+		}
+	}
+	qsort(lines, ranCount, sizeof(profile_line_t), &profile_comparelines);
+
+	fprintf(report, "Ran for %.3f ms, %.3f ms of it in instructions\n\n",
+			(profile_now() - profile->started)
+					/ PROFILE_NANOSECONDS_PER_MILLISECOND,
+			measured / PROFILE_NANOSECONDS_PER_MILLISECOND);
+	fprintf(report, "Lines by time:\n%12s %7s %12s  %s\n", "time (ms)", "%",
+			"count", "line");
+	for (int i = 0; i < ranCount; i++) {
+		parsed_instruction_t *instr = lines[i].instr;
+		fprintf(report, "%12.3f %6.2f%% %12ld  %s:%d %s\n",
+				instr->profile_nanoseconds / PROFILE_NANOSECONDS_PER_MILLISECOND,
+				profile_percent(instr->profile_nanoseconds, measured),
+				instr->run_count, lines[i].funct->name->text, instr->line_num,
+				instr->name->text);
+	}
+	free(lines);
+
+	int functionCount = profile->functions->data_length;
+	profile_function_t **sorted = malloc(
+			functionCount * sizeof(profile_function_t*));
+	memcpy(sorted, profile->functions->data,
+			functionCount * sizeof(profile_function_t*));
+	qsort(sorted, functionCount, sizeof(profile_function_t*),
+			&profile_comparefunctions);
+	fprintf(report, "\nFunctions by time:\n%12s %7s %12s %12s  %s\n",
+			"self (ms)", "%", "total (ms)", "calls", "function");
+	for (int i = 0; i < functionCount; i++)
+		fprintf(report, "%12.3f %6.2f%% %12.3f %12ld  %s\n",
+				sorted[i]->nanoseconds / PROFILE_NANOSECONDS_PER_MILLISECOND,
+				profile_percent(sorted[i]->nanoseconds, measured),
+				sorted[i]->total_nanoseconds
+						/ PROFILE_NANOSECONDS_PER_MILLISECOND, sorted[i]->calls,
+				profile_name(sorted[i], functions));
+	free(sorted);
+}
+
+void profile_free(profile_t *profile) {
+	for (int i = 0; i < profile->nodes->data_length; i++)
+		list_free(((profile_node_t*) profile->nodes->data[i])->children);
+	list_complete_free(&free, profile->nodes);
+	list_complete_free(&free, profile->functions);
+	free(profile);
+}
+
+static profile_node_t* profile_node(profile_function_t *function,
+		profile_node_t *parent, profile_t *profile) {
+	profile_node_t *node = malloc(sizeof(profile_node_t));
+	node->function = function;
+	node->parent = parent;
+	node->children = list_init();
+	node->calls = 0;
+	node->nanoseconds = 0;
+	node->total_nanoseconds = 0;
+	node->next_child = 0;
+	if (parent != NULL)
+		list_add(node, parent->children);
+	list_add(node, profile->nodes);
+	return node;
+}
+
+static profile_function_t* profile_function(function_t *funct,
+		profile_t *profile) {
+	for (int i = 0; i < profile->functions->data_length; i++)
+		if (((profile_function_t*) profile->functions->data[i])->funct == funct)
+			return profile->functions->data[i];
+
+	profile_function_t *function = calloc(1, sizeof(profile_function_t));
+	function->funct = funct;
+	list_add(function, profile->functions);
+	return function;
+}
+
+/**
+ * Goes through the tree of call stacks (without recursion, since recursive scripts make deep
+ * trees), writing the folded stacks and adding the nodes up into their functions. The total
+ * time of a function only counts its outermost call on every stack, so recursion isn't counted
+ * more than once.
+ */
+static void profile_walk(FILE *folded, list_t *functions, profile_t *profile) {
+	for (int i = 0; i < profile->functions->data_length; i++) {
+		profile_function_t *function = profile->functions->data[i];
+		function->calls = 0;
+		function->nanoseconds = function->total_nanoseconds = 0;
+		function->open_count = 0;
+	}
+
+	string_t *path = string_init();
+	list_t *pathLengths = list_init(); // where the path was before every node on the stack
+	list_t *stack = list_init();
+	profile_node_t *next = profile->root;
+	while (next != NULL || stack->data_length > 0) {
+		if (next != NULL) {
+			// Into a node
+			profile_function_t *function = next->function;
+			function->calls += next->calls;
+			function->nanoseconds += next->nanoseconds;
+			function->open_count++;
+			next->next_child = 0;
+
+			list_add((void*) (long) path->text_length, pathLengths);
+			if (path->text_length > 0)
+				string_appendchar(path, ';');
+			string_append(path, profile_name(function, functions));
+			if (next->nanoseconds > 0)
+				fprintf(folded, "%s %lld\n", path->text, next->nanoseconds);
+
+			list_add(next, stack);
+			next = NULL;
+			continue;
+		}
+
+		profile_node_t *node = stack->data[stack->data_length - 1];
+		if (node->next_child < node->children->data_length) {
+			next = node->children->data[node->next_child++];
+			continue;
+		}
+
+		// Out of a node, once all of its children are done
+		node->total_nanoseconds = node->nanoseconds;
+		for (int i = 0; i < node->children->data_length; i++)
+			node->total_nanoseconds +=
+					((profile_node_t*) node->children->data[i])->total_nanoseconds;
+		if (--node->function->open_count == 0)
+			node->function->total_nanoseconds += node->total_nanoseconds;
+
+		int length = (int) (long) pathLengths->data[pathLengths->data_length - 1];
+		memstats_capacity(MEMSTATS_STRINGS, 0, length - path->text_length);
+		path->text_length = length;
+		path->text[length] = '\0';
+		list_remove(pathLengths->data_length - 1, pathLengths);
+		list_remove(stack->data_length - 1, stack);
+	}
+	list_free(stack);
+	list_free(pathLengths);
+	string_free(path);
+}
+
+static char* profile_name(profile_function_t *function, list_t *functions) {
+	function_t *funct =
+			function->funct != NULL ? function->funct : functions->data[0];
+	return funct->name->text;
+}
+
+static double profile_percent(long long part, long long whole) {
+	return whole > 0 ? 100.0 * part / whole : 0;
+}
+
+// Slowest first
+static int profile_comparelines(const void *a, const void *b) {
+	long long timeA = ((profile_line_t*) a)->instr->profile_nanoseconds;
+	long long timeB = ((profile_line_t*) b)->instr->profile_nanoseconds;
+	return (timeA < timeB) - (timeA > timeB);
+}
+
+static int profile_comparefunctions(const void *a, const void *b) {
+	long long timeA = (*(profile_function_t**) a)->nanoseconds;
+	long long timeB = (*(profile_function_t**) b)->nanoseconds;
+	return (timeA < timeB) - (timeA > timeB);
+}
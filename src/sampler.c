@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * sampler.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+
+#include "../include/sampler.h"
+#include "../include/interpreter.h"
+#include "../include/listobj.h"
+#include "../include/stringobj.h"
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+#define SAMPLER_NANOSECONDS_PER_SECOND 1000000000L
+
+// Samples of one line or one function in the report
+typedef struct {
+	function_t *funct;
+	int index; // -1 for the function as a whole
+	long self_count, total_count;
+	long last_sample; // so recursion counts a sample only once in total_count
+} sampler_count_t;
+
+// The signal handler has no way to get a pointer other than a global
+static sampler_t *volatile sampler_running = NULL;
+
+// Static Prototypes
+static void sampler_handle(int signal);
+static unsigned int sampler_hash(sampler_site_t *sites, int depth);
+static bool sampler_samesites(sampler_site_t *a, sampler_site_t *b,
+		int depth);
+static sampler_count_t* sampler_count(function_t *funct, int index,
+		list_t *counts);
+static bool sampler_validsite(sampler_site_t *site, list_t *functions);
+static int sampler_comparecounts(const void *a, const void *b);
+
+sampler_t* sampler_init(int frequency) {
+	sampler_t *sampler = calloc(1, sizeof(sampler_t));
+	sampler->table = calloc(SAMPLER_TABLE_SIZE, sizeof(sampler_entry_t));
+	sampler->frequency = frequency > 0 ? frequency : SAMPLER_DEFAULT_FREQUENCY;
+	atomic_init(&sampler->depth, 0);
+	return sampler;
+}
+
+bool sampler_start(sampler_t *sampler) {
+	sampler->thread = (pid_t) syscall(SYS_gettid);
+	sampler_running = sampler;
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = &sampler_handle;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	if (sigaction(SIGPROF, &action, &sampler->previous_action) != 0) {
+		sampler_running = NULL;
+		return false;
+	}
+
+	// Only the CPU time of the interpreter thread counts, and the signal goes right to it
+	long interval = SAMPLER_NANOSECONDS_PER_SECOND / sampler->frequency;
+	struct sigevent event;
+	memset(&event, 0, sizeof(event));
+	event.sigev_notify = SIGEV_THREAD_ID;
+	event.sigev_signo = SIGPROF;
+	event.sigev_notify_thread_id = sampler->thread;
+	struct itimerspec timing = { { interval / SAMPLER_NANOSECONDS_PER_SECOND,
+			interval % SAMPLER_NANOSECONDS_PER_SECOND }, { interval
+			/ SAMPLER_NANOSECONDS_PER_SECOND, interval
+			% SAMPLER_NANOSECONDS_PER_SECOND } };
+	if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &sampler->timer) == 0) {
+		sampler->timer_created = true;
+		if (timer_settime(sampler->timer, 0, &timing, NULL) == 0)
+			return true;
+		timer_delete(sampler->timer);
+		sampler->timer_created = false;
+	}
+
+	// The CPU time of the whole process, where the handler ignores the other threads
+	struct itimerval profTimer = { { 0, interval / 1000 }, { 0, interval
+			/ 1000 } };
+	if (setitimer(ITIMER_PROF, &profTimer, NULL) == 0)
+		return true;
+	sigaction(SIGPROF, &sampler->previous_action, NULL);
+	sampler_running = NULL;
+	return false;
+}
+
+void sampler_stop(sampler_t *sampler) {
+	if (sampler_running != sampler)
+		return;
+	if (sampler->timer_created) {
+		timer_delete(sampler->timer);
+		sampler->timer_created = false;
+	} else {
+		struct itimerval stopped = { { 0, 0 }, { 0, 0 } };
+		setitimer(ITIMER_PROF, &stopped, NULL);
+	}
+	sigaction(SIGPROF, &sampler->previous_action, NULL);
+	sampler_running = NULL;
+}
+
+sampler_frame_t* sampler_enter(function_t *funct, bool tail,
+		sampler_t *sampler) {
+	int depth = atomic_load_explicit(&sampler->depth, memory_order_relaxed);
+	if (tail && depth > 0)
+		depth--;
+	sampler_frame_t *frame =
+			depth < SAMPLER_MAX_DEPTH ? &sampler->stack[depth] : &sampler->overflow;
+	frame->funct = funct;
+	atomic_store_explicit(&frame->index, 0, memory_order_relaxed);
+	// The frame has to be complete before the handler can see it
+	atomic_signal_fence(memory_order_release);
+	atomic_store_explicit(&sampler->depth, depth + 1, memory_order_relaxed);
+	return frame;
+}
+
+sampler_frame_t* sampler_leave(function_t *caller, sampler_t *sampler) {
+	int depth = atomic_load_explicit(&sampler->depth, memory_order_relaxed);
+	if (depth > 0)
+		depth--;
+	if (depth <= SAMPLER_MAX_DEPTH) {
+		atomic_store_explicit(&sampler->depth, depth, memory_order_relaxed);
+		return &sampler->stack[depth > 0 ? depth - 1 : 0];
+	}
+	// The innermost frame is the caller again, hidden from the handler while it changes
+	sampler_frame_t *frame = &sampler->overflow;
+	atomic_store_explicit(&sampler->depth, SAMPLER_MAX_DEPTH, memory_order_relaxed);
+	atomic_signal_fence(memory_order_release);
+	frame->funct = caller;
+	atomic_store_explicit(&frame->index, 0, memory_order_relaxed);
+	atomic_signal_fence(memory_order_release);
+	atomic_store_explicit(&sampler->depth, depth, memory_order_relaxed);
+	return frame;
+}
+
+void sampler_report(FILE *report, FILE *folded, list_t *functions,
+		sampler_t *sampler) {
+	list_t *lines = list_init(), *functionCounts = list_init();
+	string_t *path = string_init();
+	long validCount = 0;
+	for (int i = 0; i < SAMPLER_TABLE_SIZE; i++) {
+		sampler_entry_t *entry = &sampler->table[i];
+		if (entry->depth == 0)
+			continue;
+		// A sample taken right in the middle of a call can have a frame that isn't finished
+		bool valid = true;
+		for (int j = 0; j < entry->depth && valid; j++)
+			valid = sampler_validsite(&entry->sites[j], functions);
+		if (!valid)
+			continue;
+		validCount += entry->count;
+
+		string_reset(path);
+		for (int j = 0; j < entry->depth; j++) {
+			sampler_site_t *site = &entry->sites[j];
+			parsed_instruction_t *instr =
+					site->funct->parsed_instructions->data[site->index];
+			char frame[32];
+			snprintf(frame, sizeof(frame), ":%d", instr->line_num);
+			if (j > 0)
+				string_appendchar(path, ';');
+			if (j == entry->depth - 1 && entry->truncated)
+				string_append(path, "...;"); // the frames that didn't fit
+			string_append_s(path, site->funct->name);
+			string_append(path, frame);
+
+			// Every function on the stack gets the sample once, the innermost one as its own
+			sampler_count_t *function = sampler_count(site->funct, -1,
+					functionCounts);
+			if (function->last_sample != i + 1) {
+				function->total_count += entry->count;
+				function->last_sample = i + 1;
+			}
+			if (j == entry->depth - 1) {
+				function->self_count += entry->count;
+				sampler_count(site->funct, site->index, lines)->self_count +=
+						entry->count;
+			}
+		}
+		fprintf(folded, "%s %ld\n", path->text, entry->count);
+	}
+	string_free(path);
+
+	fprintf(report,
+			"%ld samples, %d per second of CPU time asked for (%ld not attributed, %ld dropped)\n\n",
+			sampler->sample_count, sampler->frequency,
+			sampler->sample_count - validCount - sampler->dropped_count,
+			sampler->dropped_count);
+	qsort(lines->data, lines->data_length, sizeof(void*),
+			&sampler_comparecounts);
+	fprintf(report, "Lines by samples:\n%10s %7s  %s\n", "samples", "%",
+			"line");
+	for (int i = 0; i < lines->data_length; i++) {
+		sampler_count_t *line = lines->data[i];
+		parsed_instruction_t *instr =
+				line->funct->parsed_instructions->data[line->index];
+		fprintf(report, "%10ld %6.2f%%  %s:%d %s\n", line->self_count,
+				100.0 * line->self_count / validCount, line->funct->name->text,
+				instr->line_num, instr->name->text);
+	}
+
+	qsort(functionCounts->data, functionCounts->data_length, sizeof(void*),
+			&sampler_comparecounts);
+	fprintf(report, "\nFunctions by samples:\n%10s %7s %10s %7s  %s\n", "self",
+			"%", "total", "%", "function");
+	for (int i = 0; i < functionCounts->data_length; i++) {
+		sampler_count_t *function = functionCounts->data[i];
+		fprintf(report, "%10ld %6.2f%% %10ld %6.2f%%  %s\n",
+				function->self_count, 100.0 * function->self_count / validCount,
+				function->total_count,
+				100.0 * function->total_count / validCount,
+				function->funct->name->text);
+	}
+	list_complete_free(&free, lines);
+	list_complete_free(&free, functionCounts);
+}
+
+void sampler_free(sampler_t *sampler) {
+	sampler_stop(sampler);
+	free(sampler->table);
+	free(sampler);
+}
+
+/**
+ * Adds the call stack that is running to the table. Nothing in here allocates or locks, since
+ * the signal can come in the middle of anything (including malloc()).
+ */
+static void sampler_handle(int signal) {
+	(void) signal;
+	int savedErrno = errno;
+	sampler_t *sampler = sampler_running;
+	if (sampler == NULL || (pid_t) syscall(SYS_gettid) != sampler->thread) {
+		errno = savedErrno;
+		return;
+	}
+	int depth = atomic_load_explicit(&sampler->depth, memory_order_relaxed);
+	atomic_signal_fence(memory_order_acquire);
+	if (depth == 0) {
+		errno = savedErrno;
+		return; // the script hasn't started yet
+	}
+	sampler->sample_count++;
+
+	bool truncated = depth > SAMPLER_MAX_DEPTH;
+	if (truncated)
+		depth = SAMPLER_MAX_DEPTH;
+	sampler_site_t sites[SAMPLER_MAX_DEPTH];
+	for (int i = 0; i < depth; i++) {
+		sampler_frame_t *frame =
+				truncated && i == depth - 1 ?
+						&sampler->overflow : &sampler->stack[i];
+		sites[i].funct = frame->funct;
+		sites[i].index = atomic_load_explicit(&frame->index,
+				memory_order_relaxed);
+	}
+	unsigned int hash = sampler_hash(sites, depth) ^ truncated;
+
+	for (int probe = 0; probe < SAMPLER_TABLE_SIZE; probe++) {
+		sampler_entry_t *entry = &sampler->table[(hash + probe)
+				% SAMPLER_TABLE_SIZE];
+		if (entry->depth == 0) {
+			entry->hash = hash;
+			entry->truncated = truncated;
+			memcpy(entry->sites, sites, depth * sizeof(sampler_site_t));
+			entry->count = 1;
+			entry->depth = depth;
+			errno = savedErrno;
+			return;
+		}
+		if (entry->hash == hash && entry->depth == depth
+				&& entry->truncated == truncated
+				&& sampler_samesites(entry->sites, sites, depth)) {
+			entry->count++;
+			errno = savedErrno;
+			return;
+		}
+	}
+	sampler->dropped_count++;
+	errno = savedErrno;
+}
+
+// FNV-1a over the functions and instruction indexes
+static unsigned int sampler_hash(sampler_site_t *sites, int depth) {
+	unsigned int hash = 2166136261u;
+	for (int i = 0; i < depth; i++) {
+		unsigned long values[2] = { (unsigned long) sites[i].funct,
+				(unsigned long) sites[i].index };
+		unsigned char *bytes = (unsigned char*) values;
+		for (size_t j = 0; j < sizeof(values); j++) {
+			hash ^= bytes[j];
+			hash *= 16777619u;
+		}
+	}
+	return hash;
+}
+
+// Field by field, since the padding of the sites isn't initialized
+static bool sampler_samesites(sampler_site_t *a, sampler_site_t *b,
+		int depth) {
+	for (int i = 0; i < depth; i++)
+		if (a[i].funct != b[i].funct || a[i].index != b[i].index)
+			return false;
+	return true;
+}
+
+static sampler_count_t* sampler_count(function_t *funct, int index,
+		list_t *counts) {
+	for (int i = 0; i < counts->data_length; i++) {
+		sampler_count_t *count = counts->data[i];
+		if (count->funct == funct && count->index == index)
+			return count;
+	}
+	sampler_count_t *count = calloc(1, sizeof(sampler_count_t));
+	count->funct = funct;
+	count->index = index;
+	list_add(count, counts);
+	return count;
+}
+
+static bool sampler_validsite(sampler_site_t *site, list_t *functions) {
+	for (int i = 0; i < functions->data_length; i++)
+		if (functions->data[i] == site->funct)
+			return site->index >= 0
+					&& site->index < site->funct->parsed_instructions->data_length;
+	return false;
+}
+
+// Most samples first
+static int sampler_comparecounts(const void *a, const void *b) {
+	long countA = (*(sampler_count_t**) a)->self_count;
+	long countB = (*(sampler_count_t**) b)->self_count;
+	return (countA < countB) - (countA > countB);
+}
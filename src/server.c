@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * server.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "../include/server.h"
+#include "../include/interpreter.h"
+#include "../include/stringobj.h"
+#include "../include/source.h"
+#include "../include/throwable.h"
+
+// Static Prototypes
+static int server_connect(char *socketPath);
+static pid_t server_forkworker(int listener, list_t *scripts,
+		output_flush_policy policy);
+static bool server_readrequest(int client, string_t *request);
+static server_script_t* server_findscript(string_t *name, list_t *scripts);
+static bool server_loadscript(server_script_t *script);
+static void server_reloadscripts(list_t *scripts);
+static bool server_runtoplevel(server_script_t *script);
+static void server_restoreglobals(server_script_t *script);
+
+int server_run(char *socketPath, list_t *scripts, output_flush_policy policy) {
+	for (int i = 0; i < scripts->data_length; i++)
+		if (!server_runtoplevel(scripts->data[i])) {
+			server_freescripts(scripts);
+			return EXIT_FAILURE;
+		}
+
+	int listener = server_listen(socketPath);
+	if (listener == -1) {
+		server_freescripts(scripts);
+		return EXIT_FAILURE;
+	}
+
+	// A client that disconnects early shouldn't take the whole server down with it
+	signal(SIGPIPE, SIG_IGN);
+
+	while (true) {
+		int client = accept(listener, NULL, NULL);
+		if (client == -1) {
+			if (errno == EINTR)
+				continue;
+			throw_exception(ERRNO_EXCEPTION, -1, "Unable to accept a client");
+			break;
+		}
+		// Nothing is running in between requests, so the functions can be replaced
+		server_reloadscripts(scripts);
+		server_handle(client, scripts, true, policy);
+		close(client);
+	}
+
+	close(listener);
+	unlink(socketPath);
+	server_freescripts(scripts);
+	return EXIT_FAILURE;
+}
+
+int server_prefork(char *socketPath, list_t *scripts, int workerCount,
+		output_flush_policy policy) {
+	// Global variables are set up once, before the workers get their copy. So are the
+	// function bodies, or every worker would parse the ones it calls all over again.
+	for (int i = 0; i < scripts->data_length; i++) {
+		if (!server_runtoplevel(scripts->data[i])) {
+			server_freescripts(scripts);
+			return EXIT_FAILURE;
+		}
+		interpreter_loadall(((server_script_t*) scripts->data[i])->vm);
+	}
+
+	int listener = server_listen(socketPath);
+	if (listener == -1) {
+		server_freescripts(scripts);
+		return EXIT_FAILURE;
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	int runningCount = 0;
+	for (int i = 0; i < workerCount; i++)
+		if (server_forkworker(listener, scripts, policy) > 0)
+			runningCount++;
+
+	// Every worker answers one request and exits, and is then replaced by a fresh one
+	while (runningCount > 0) {
+		int status;
+		pid_t worker = waitpid(-1, &status, 0);
+		if (worker == -1) {
+			if (errno == EINTR)
+				continue;
+			throw_exception(ERRNO_EXCEPTION, -1, "Unable to wait for workers");
+			break;
+		}
+		runningCount--;
+
+		if (WIFSIGNALED(status))
+			fprintf(stderr, "Worker %d was stopped by signal %d\n", (int) worker,
+					WTERMSIG(status));
+		else if (WIFEXITED(status)
+				&& WEXITSTATUS(status) == SERVER_WORKER_FAILED)
+			continue; // forking another one would fail the same way
+
+		// The workers that are already waiting keep the program they were forked with
+		server_reloadscripts(scripts);
+		for (int i = 0; i < scripts->data_length; i++)
+			interpreter_loadall(((server_script_t*) scripts->data[i])->vm);
+		if (server_forkworker(listener, scripts, policy) > 0)
+			runningCount++;
+	}
+
+	close(listener);
+	unlink(socketPath);
+	server_freescripts(scripts);
+	return EXIT_FAILURE;
+}
+
+int server_call(char *socketPath, char *request) {
+	int server = server_connect(socketPath);
+	if (server == -1)
+		return -1;
+
+	size_t length = strlen(request);
+	if (write(server, request, length) != (ssize_t) length
+			|| write(server, "\n", 1) != 1) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to send the request");
+		close(server);
+		return -1;
+	}
+	shutdown(server, SHUT_WR);
+
+	// Everything before the '\0' is output, everything after it is the error count and the
+	// exceptions
+	string_t *status = string_init();
+	bool inStatus = false;
+	char buffer[4096];
+	ssize_t readCount;
+	while ((readCount = read(server, buffer, sizeof(buffer))) > 0) {
+		char *start = buffer;
+		if (!inStatus) {
+			char *end = memchr(buffer, '\0', readCount);
+			fwrite(buffer, sizeof(char),
+					(end != NULL ? end : buffer + readCount) - buffer, stdout);
+			if (end == NULL)
+				continue;
+			inStatus = true;
+			start = end + 1;
+		}
+		string_appendn(status, start, buffer + readCount - start);
+	}
+	fflush(stdout);
+	close(server);
+
+	int errorCount = inStatus ? atoi(status->text) : -1;
+	char *exceptions = strchr(status->text, '\n');
+	if (exceptions != NULL) {
+		fputs(exceptions + 1, stderr);
+		fflush(stderr);
+	}
+	string_free(status);
+	return errorCount;
+}
+
+list_t* server_loadscripts(char **scriptPaths, int scriptCount) {
+	list_t *scripts = list_init();
+	for (int i = 0; i < scriptCount; i++) {
+		server_script_t *script = malloc(sizeof(server_script_t));
+		char *slash = strrchr(scriptPaths[i], '/');
+		script->name = strdup(slash != NULL ? slash + 1 : scriptPaths[i]);
+		script->path = strdup(scriptPaths[i]);
+		script->modified.tv_sec = 0;
+		script->modified.tv_nsec = 0;
+		script->size = -1;
+		script->vm = vm_init();
+		script->globals = NULL;
+		script->global_count = 0;
+		list_add(script, scripts);
+
+		if (!server_loadscript(script)) {
+			server_freescripts(scripts);
+			return NULL;
+		}
+	}
+	return scripts;
+}
+
+void server_freescripts(list_t *scripts) {
+	for (int i = 0; i < scripts->data_length; i++) {
+		server_script_t *script = scripts->data[i];
+		free(script->name);
+		free(script->path);
+		for (int j = 0; j < script->global_count; j++)
+			value_clear(&script->globals[j]);
+		free(script->globals);
+		vm_free(script->vm);
+		free(script);
+	}
+	list_free(scripts);
+}
+
+int server_listen(char *socketPath) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(address.sun_path)) {
+		throw_exception(INDEX_OUT_OF_BOUNDS_EXCEPTION, -1,
+				"The socket path %s is too long!", socketPath);
+		return -1;
+	}
+	strcpy(address.sun_path, socketPath);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == -1) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to create a socket");
+		return -1;
+	}
+	unlink(socketPath);
+	if (bind(listener, (struct sockaddr*) &address, sizeof(address)) == -1
+			|| listen(listener, SOMAXCONN) == -1) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to listen on %s",
+				socketPath);
+		close(listener);
+		return -1;
+	}
+	return listener;
+}
+
+void server_handle(int client, list_t *scripts, bool reset,
+		output_flush_policy policy) {
+	string_t *request = string_init();
+	if (!server_readrequest(client, request)) {
+		string_free(request);
+		return;
+	}
+
+	// The exceptions of the request go back to the client as well
+	char *exceptions = NULL;
+	size_t exceptionsLength = 0;
+	FILE *exceptionStream = open_memstream(&exceptions, &exceptionsLength);
+	throw_capture(exceptionStream);
+
+	int errorCount = 1;
+	output_t *output = output_init(client,
+			policy != 0 ? policy : OUTPUT_FLUSH_SIZE);
+	string_t **scriptAndCall = string_split(' ', request);
+	if (scriptAndCall == NULL) {
+		throw_exception(SYNTAX_EXCEPTION, 0,
+				"Expected a script and a function to run, but got \"%s\"!",
+				request->text);
+	} else {
+		server_script_t *script = server_findscript(scriptAndCall[0], scripts);
+		if (script == NULL) {
+			throw_exception(NULL_POINTER_EXCEPTION, 0,
+					"There is no script called \"%s\"!",
+					scriptAndCall[0]->text);
+		} else {
+			vm_t *vm = script->vm;
+			output_t *previousOutput = vm->output;
+			parsed_instruction_t *call = parse(vm->set_delimiter,
+					vm->arg_delimiter, scriptAndCall[1]);
+
+			// Every request starts from the program as its top level code left it
+			if (reset)
+				server_restoreglobals(script);
+			vm->output = output;
+			interpreter_call(call, vm);
+			vm->output = previousOutput;
+			errorCount = vm->error_count;
+
+			parsed_instruction_free(call);
+		}
+		string_free(scriptAndCall[0]);
+		string_free(scriptAndCall[1]);
+		free(scriptAndCall);
+	}
+
+	throw_capture(NULL);
+	output_appendchar(output, '\0');
+	output_appenddouble(output, errorCount);
+	output_appendchar(output, '\n');
+	if (exceptionStream != NULL) {
+		fclose(exceptionStream);
+		output_append(output, exceptions, exceptionsLength);
+		free(exceptions);
+	}
+	output_free(output);
+	string_free(request);
+}
+
+static pid_t server_forkworker(int listener, list_t *scripts,
+		output_flush_policy policy) {
+	// Anything still buffered would be written once by every child otherwise
+	fflush(stdout);
+	fflush(stderr);
+
+	pid_t worker = fork();
+	if (worker == -1) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to fork a worker");
+		return -1;
+	}
+	if (worker > 0)
+		return worker;
+
+	// The worker doesn't outlive the server
+	prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+	int client;
+	do {
+		client = accept(listener, NULL, NULL);
+	} while (client == -1 && errno == EINTR);
+	if (client == -1) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to accept a client");
+		_exit(SERVER_WORKER_FAILED);
+	}
+
+	server_handle(client, scripts, false, policy);
+	close(client);
+	// Nothing needs to be freed, the whole process is about to be thrown away
+	_exit(EXIT_SUCCESS);
+}
+
+static int server_connect(char *socketPath) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server == -1
+			|| connect(server, (struct sockaddr*) &address, sizeof(address))
+					== -1) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to connect to %s",
+				socketPath);
+		if (server != -1)
+			close(server);
+		return -1;
+	}
+	return server;
+}
+
+static bool server_readrequest(int client, string_t *request) {
+	char buffer[4096];
+	ssize_t readCount;
+	while ((readCount = read(client, buffer, sizeof(buffer))) > 0) {
+		char *newline = memchr(buffer, '\n', readCount);
+		string_appendn(request, buffer,
+				(newline != NULL ? newline : buffer + readCount) - buffer);
+		if (newline != NULL)
+			break;
+		if (request->text_length > SERVER_MAX_REQUEST_LENGTH) {
+			throw_exception(INDEX_OUT_OF_BOUNDS_EXCEPTION, -1,
+					"A request was longer than %d bytes!",
+					SERVER_MAX_REQUEST_LENGTH);
+			return false;
+		}
+	}
+	while (request->text_length > 0
+			&& request->text[request->text_length - 1] == '\r')
+		request->text[--request->text_length] = '\0';
+	return request->text_length > 0;
+}
+
+static server_script_t* server_findscript(string_t *name, list_t *scripts) {
+	for (int i = 0; i < scripts->data_length; i++)
+		if (string_equals(name, ((server_script_t*) scripts->data[i])->name))
+			return scripts->data[i];
+	return NULL;
+}
+
+// Loads the script if its file changed since it was last loaded (or was never loaded)
+static bool server_loadscript(server_script_t *script) {
+	struct stat info;
+	if (stat(script->path, &info) == -1) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to open %s", script->path);
+		return false;
+	}
+	if (info.st_mtim.tv_sec == script->modified.tv_sec
+			&& info.st_mtim.tv_nsec == script->modified.tv_nsec
+			&& info.st_size == script->size)
+		return true;
+	// A file with errors isn't loaded again until it changes again
+	script->modified = info.st_mtim;
+	script->size = info.st_size;
+
+	FILE *stream = fopen(script->path, "r");
+	if (stream == NULL) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to open %s", script->path);
+		return false;
+	}
+	source_map_t *source = source_read(stream, script->vm);
+	fclose(stream);
+	if (source == NULL) {
+		throw_exception(ERRNO_EXCEPTION, -1, "Unable to read %s", script->path);
+		return false;
+	}
+	return interpreter_reload(source, script->vm);
+}
+
+static void server_reloadscripts(list_t *scripts) {
+	for (int i = 0; i < scripts->data_length; i++) {
+		server_script_t *script = scripts->data[i];
+		// A reload that went through has replaced the function list
+		list_t *functions = script->vm->function_list;
+		if (server_loadscript(script) && script->vm->function_list != functions)
+			server_runtoplevel(script);
+	}
+}
+
+// Runs the top level code from scratch, and keeps the global variables it leaves behind
+static bool server_runtoplevel(server_script_t *script) {
+	vm_t *vm = script->vm;
+	vm_reset(vm);
+	interpreter_run(vm);
+
+	for (int i = 0; i < script->global_count; i++)
+		value_clear(&script->globals[i]);
+	script->global_count = vm->global_variables->data_length;
+	script->globals = realloc(script->globals,
+			script->global_count * sizeof(value_t));
+	for (int i = 0; i < script->global_count; i++) {
+		value_t value =
+				*(value_t*) ((te_variable*) vm->global_variables->data[i])->address;
+		script->globals[i] =
+				value_isstring(value) ?
+						value_string(string_copyvalueof_s(value_text(value))) :
+						value;
+	}
+	return vm->error_count == 0;
+}
+
+// Puts the global variables back the way the top level code left them, and clears the rest
+static void server_restoreglobals(server_script_t *script) {
+	vm_t *vm = script->vm;
+	vm_reset(vm);
+	// Globals are only ever added to the end, so the ones a request created come last
+	for (int i = 0; i < script->global_count; i++) {
+		value_t value = script->globals[i];
+		*(value_t*) ((te_variable*) vm->global_variables->data[i])->address =
+				value_isstring(value) ?
+						value_string(string_copyvalueof_s(value_text(value))) :
+						value;
+	}
+}
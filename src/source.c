@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * source.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../include/source.h"
+
+#define SOURCE_READ_SIZE 65536
+
+// Static Prototypes
+static bool source_isinstruction(char *text, int length, string_t *name,
+		vm_t *vm);
+static string_t* source_header(char *text, int length, vm_t *vm);
+static unsigned int source_mix(unsigned int hash, unsigned int value);
+static void source_freespan(void *span);
+
+source_map_t* source_skim(char *text, size_t length, vm_t *vm) {
+	source_map_t *source = malloc(sizeof(source_map_t));
+	source->text = text;
+	source->length = length;
+	source->spans = list_init();
+	source->names = map_init();
+	source->main_hash = 0;
+	source->main_length = 0;
+	source->nested = false;
+
+	source_span_t *span = NULL; // the function the line is in
+	int depth = 0, lineNum = 0;
+	char *end = text + length;
+	for (char *current = text; current < end;) {
+		char *newline = memchr(current, '\n', end - current);
+		char *next = newline != NULL ? newline + 1 : end;
+		lineNum++;
+
+		// Trimmed like preprocess_line() does
+		char *line = current;
+		int lineLength = (newline != NULL ? newline : end) - current;
+		while (lineLength > 0 && isspace((unsigned char ) *line)) {
+			line++;
+			lineLength--;
+		}
+		while (lineLength > 0 && isspace((unsigned char ) line[lineLength - 1]))
+			lineLength--;
+
+		if (lineLength == 0 || *line == vm->comment_delimiter) {
+			// Blank lines don't change anything
+		} else if (source_isinstruction(line, lineLength, vm->function_declare,
+				vm)) {
+			if (depth++ > 0) {
+				source->nested = true;
+			} else {
+				span = malloc(sizeof(source_span_t));
+				span->name = source_header(line, lineLength, vm);
+				span->start = current;
+				span->first_line = lineNum;
+			}
+		} else if (depth > 0
+				&& source_isinstruction(line, lineLength, vm->function_end,
+						vm)) {
+			if (--depth == 0) {
+				span->end = next;
+				span->last_line = lineNum;
+				span->hash = map_hash(span->start, span->end - span->start);
+				list_add(span, source->spans);
+				map_put(span->name, span, source->names);
+				span = NULL;
+			}
+		} else if (depth == 0) {
+			source->main_hash = source_mix(
+					source_mix(source->main_hash, lineNum),
+					map_hash(line, lineLength));
+			source->main_length += lineLength;
+		}
+		current = next;
+	}
+	if (span != NULL) {
+		source->nested = true;
+		source_freespan(span);
+	}
+	return source;
+}
+
+source_map_t* source_read(FILE *stream, vm_t *vm) {
+	size_t length = 0, capacity = SOURCE_READ_SIZE;
+	char *text = malloc(capacity);
+	size_t readCount;
+	while ((readCount = fread(text + length, 1, capacity - length, stream)) > 0) {
+		length += readCount;
+		if (length == capacity)
+			text = realloc(text, capacity *= 2);
+	}
+	if (ferror(stream)) {
+		free(text);
+		return NULL;
+	}
+	return source_skim(text, length, vm);
+}
+
+source_span_t* source_findspan(string_t *name, source_map_t *source) {
+	return map_get(name, source->names);
+}
+
+bool source_samespan(source_span_t *span, source_span_t *other) {
+	return span->hash == other->hash
+			&& span->end - span->start == other->end - other->start
+			&& memcmp(span->start, other->start, span->end - span->start) == 0;
+}
+
+bool source_samemain(source_map_t *source, source_map_t *other) {
+	if (source->main_hash != other->main_hash
+			|| source->main_length != other->main_length
+			|| source->spans->data_length != other->spans->data_length)
+		return false;
+
+	// The top level code is what is between the functions, which has to start on the same line
+	char *segment = source->text, *otherSegment = other->text;
+	int lineNum = 0, otherLineNum = 0;
+	for (int i = 0; i <= source->spans->data_length; i++) {
+		source_span_t *span =
+				i < source->spans->data_length ? source->spans->data[i] : NULL;
+		source_span_t *otherSpan =
+				i < other->spans->data_length ? other->spans->data[i] : NULL;
+		char *end = span != NULL ? span->start : source->text + source->length;
+		char *otherEnd =
+				otherSpan != NULL ?
+						otherSpan->start : other->text + other->length;
+		if (lineNum != otherLineNum || end - segment != otherEnd - otherSegment
+				|| memcmp(segment, otherSegment, end - segment) != 0)
+			return false;
+		if (span == NULL)
+			break;
+		segment = span->end;
+		otherSegment = otherSpan->end;
+		lineNum = span->last_line;
+		otherLineNum = otherSpan->last_line;
+	}
+	return true;
+}
+
+void source_free(source_map_t *source) {
+	list_complete_free(&source_freespan, source->spans);
+	map_free(source->names);
+	free(source->text);
+	free(source);
+}
+
+// Tells instructions apart the same way that parse() does
+static bool source_isinstruction(char *text, int length, string_t *name,
+		vm_t *vm) {
+	char *delimiter = memchr(text, vm->set_delimiter, length);
+	if (delimiter != NULL)
+		return delimiter - text == name->text_length
+				&& memcmp(text, name->text, name->text_length) == 0;
+
+	// Without arguments, only the letters and digits are part of the name
+	int matched = 0;
+	for (int i = 0; i < length; i++) {
+		if (!isalnum((unsigned char ) text[i]))
+			continue;
+		if (matched == name->text_length || text[i] != name->text[matched])
+			return false;
+		matched++;
+	}
+	return matched == name->text_length;
+}
+
+// The name of the function, which is the first argument of the header
+static string_t* source_header(char *text, int length, vm_t *vm) {
+	string_t *name = string_init();
+	char *delimiter = memchr(text, vm->set_delimiter, length);
+	if (delimiter == NULL)
+		return name;
+	for (char *letter = delimiter + 1;
+			letter < text + length && *letter != vm->arg_delimiter; letter++)
+		if (!isspace((unsigned char ) *letter))
+			string_appendchar(name, *letter);
+	return name;
+}
+
+static unsigned int source_mix(unsigned int hash, unsigned int value) {
+	return (hash ^ value) * 16777619u;
+}
+
+static void source_freespan(void *span) {
+	string_free(((source_span_t*) span)->name);
+	free(span);
+}
@@ -34,6 +34,7 @@
 #include <ctype.h>
 
 #include "../include/stringobj.h"
+#include "../include/memstats.h"
 #include "../include/throwable.h"
 
 /*
@@ -47,10 +48,12 @@ static string_t* custom_string_init(int allocationSize);
 static void string_meminspection(int addNum, string_t *subject);
 
 string_t* string_init() {
-	string_t *str = malloc(sizeof(string_t));
+	string_t *str = memstats_malloc(sizeof(string_t), MEMSTATS_STRINGS);
 
-	str->text = malloc(STRING_ALLOCATION_SIZE * sizeof(char));
+	str->text = memstats_malloc(STRING_ALLOCATION_SIZE * sizeof(char),
+			MEMSTATS_STRINGS);
 	str->text[0] = '\0';
+	memstats_capacity(MEMSTATS_STRINGS, STRING_ALLOCATION_SIZE, 1);
 
 	str->text_length = 0;
 	str->text_allocated_length = STRING_ALLOCATION_SIZE;
@@ -59,10 +62,12 @@ string_t* string_init() {
 }
 
 static string_t* custom_string_init(int allocationSize) {
-	string_t *str = malloc(sizeof(string_t));
+	string_t *str = memstats_malloc(sizeof(string_t), MEMSTATS_STRINGS);
 
-	str->text = malloc(allocationSize * sizeof(char));
+	str->text = memstats_malloc(allocationSize * sizeof(char),
+			MEMSTATS_STRINGS);
 	str->text[0] = '\0';
+	memstats_capacity(MEMSTATS_STRINGS, allocationSize, 1);
 
 	str->text_length = 0;
 	str->text_allocated_length = allocationSize;
@@ -74,17 +79,20 @@ string_t* string_copyvalueof(char *src) {
 	int srcLength = strlen(src);
 
 	string_t *newStr = custom_string_init(srcLength + STRING_ALLOCATION_SIZE);
-	strncpy(newStr->text, src, srcLength);
+	memcpy(newStr->text, src, srcLength);
+	newStr->text[srcLength] = '\0';
 	newStr->text_length = srcLength;
+	memstats_capacity(MEMSTATS_STRINGS, 0, srcLength);
 
 	return newStr;
 }
 
 string_t* string_copyvalueof_s(string_t *src) {
-	// QUESTION: does memcpy() even work?
 	string_t *dest = custom_string_init(src->text_allocated_length);
-	strncpy(dest->text, src->text, src->text_length);
+	memcpy(dest->text, src->text, src->text_length);
+	dest->text[src->text_length] = '\0';
 	dest->text_length = src->text_length;
+	memstats_capacity(MEMSTATS_STRINGS, 0, src->text_length);
 
 	return dest;
 }
@@ -103,6 +111,13 @@ void string_append_s(string_t *dest, string_t *src) {
 	dest->text_length += src->text_length;
 }
 
+void string_appendn(string_t *dest, char *src, int length) {
+	string_meminspection(length, dest);
+	memcpy(dest->text + dest->text_length, src, length);
+	dest->text_length += length;
+	dest->text[dest->text_length] = '\0';
+}
+
 void string_appendchar(string_t *dest, char letter) {
 	string_meminspection(1, dest);
 
@@ -112,35 +127,28 @@ void string_appendchar(string_t *dest, char letter) {
 //	strncat(dest->text, tempLetter, 1);
 	dest->text[dest->text_length] = letter;
 	dest->text[dest->text_length + 1] = '\0';
+	dest->text_length++;
 }
 
 string_t** string_split(char delimiter, string_t *src) {
-	// Safety
-	// If the string is length 2 or less, then it is not possible to split the string
-	if (src->text_length <= 2)
-		throw_exception(INDEX_OUT_OF_BOUNDS_EXCEPTION, -1,
-				"Unable to substring a string with %d length!",
-				src->text_length);
-
-	string_t **strList = malloc(2 * sizeof(string_t));
-	strList[0] = custom_string_init(src->text_length / 2);
-	strList[1] = custom_string_init(src->text_length / 2);
-
 	char delimiterText[2];
 	delimiterText[0] = delimiter;
 	delimiterText[1] = '\0';
 	int splitIndex = strcspn(src->text, delimiterText);
 
-	if (splitIndex == src->text) {
+	// Safety
+	// If the delimiter is not present, then it is not possible to split the string
+	if (splitIndex == src->text_length)
 		return NULL;
-	}
 
-	for (int i = 0; i < splitIndex; i++) {
-		string_appendchar(strList[0], src->text[i]);
-	}
-	for (int i = splitIndex + 1; i < src->text_length; i++) {
-		string_appendchar(strList[1], src->text[i]);
-	}
+	string_t **strList = malloc(2 * sizeof(string_t*));
+	strList[0] = custom_string_init(splitIndex + STRING_ALLOCATION_SIZE);
+	strList[1] = custom_string_init(
+			src->text_length - splitIndex + STRING_ALLOCATION_SIZE);
+
+	string_appendn(strList[0], src->text, splitIndex);
+	string_appendn(strList[1], src->text + splitIndex + 1,
+			src->text_length - splitIndex - 1);
 
 	return strList;
 }
@@ -157,7 +165,7 @@ bool string_equals_s(string_t *dest, string_t *src) {
 	if (dest->text_length != src->text_length)
 		return false;
 	else
-		return strncmp(dest->text, src, src->text_length) == 0;
+		return strncmp(dest->text, src->text, src->text_length) == 0;
 }
 
 bool string_equalsignorecase(string_t *dest, char *src) {
@@ -183,7 +191,9 @@ bool string_equalsignorecase_s(string_t *dest, string_t *src) {
 }
 
 bool string_startswith_s(string_t *src, string_t *search) {
-	return strcspn(src->text, search->text) != src->text_length;
+	if (search->text_length > src->text_length)
+		return false;
+	return strncmp(src->text, search->text, search->text_length) == 0;
 }
 
 void string_tolowercase_s(string_t *dest) {
@@ -194,6 +204,7 @@ void string_tolowercase_s(string_t *dest) {
 }
 
 void string_reset(string_t *dest) {
+	memstats_capacity(MEMSTATS_STRINGS, 0, -dest->text_length);
 	dest->text[0] = '\0';
 	dest->text_length = 0;
 }
@@ -205,27 +216,37 @@ void string_serialize(string_t *src, FILE *stream) {
 
 string_t* string_deserialize(FILE *stream) {
 	int textLength;
-	fread(&textLength, sizeof(int), 1, stream);
+	if (fread(&textLength, sizeof(int), 1, stream) != 1 || textLength < 0)
+		textLength = 0; // the caller can see the error with ferror() or feof()
 
 	string_t *str = custom_string_init(textLength + STRING_ALLOCATION_SIZE);
-	fread(str->text, sizeof(char), textLength, stream);
+	textLength = fread(str->text, sizeof(char), textLength, stream);
+	str->text[textLength] = '\0';
 	str->text_length = textLength;
+	memstats_capacity(MEMSTATS_STRINGS, 0, textLength);
 
 	return str;
 }
 
 void string_free(void *dest) {
+	memstats_capacity(MEMSTATS_STRINGS,
+			-((string_t*) dest)->text_allocated_length,
+			-((string_t*) dest)->text_length - 1);
 	// Free string inside dest
-	free(((string_t*) dest)->text);
+	memstats_free(((string_t*) dest)->text, MEMSTATS_STRINGS);
 	// Free the structure itself
-	free(((string_t*) dest));
+	memstats_free(((string_t*) dest), MEMSTATS_STRINGS);
 }
 
-// Memory related functions
+// Memory related functions (called right before the length grows by addNum)
 static void string_meminspection(int addNum, string_t *subject) {
+	memstats_capacity(MEMSTATS_STRINGS, 0, addNum);
 	if (subject->text_length + addNum + 1 >= subject->text_allocated_length) {
-		addNum += subject->text_length / 2;
-		char *tempStr = (char*) realloc(subject->text, addNum * sizeof(char));
+		addNum += subject->text_length / 2 + 1;
+		char *tempStr = (char*) memstats_realloc(subject->text,
+				(subject->text_allocated_length + addNum) * sizeof(char),
+				MEMSTATS_STRINGS);
+		memstats_capacity(MEMSTATS_STRINGS, addNum, 0);
 
 		// Safety
 		if (tempStr == NULL)
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * threadpool.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../include/threadpool.h"
+#include "../include/throwable.h"
+
+// Static Prototypes
+static void* threadpool_worker(void *arg);
+
+threadpool_t* threadpool_init(int thread_count) {
+	threadpool_t *pool = malloc(sizeof(threadpool_t));
+
+	if (thread_count <= 0)
+		thread_count = threadpool_cpucount();
+
+	pool->threads = malloc(thread_count * sizeof(pthread_t));
+	pool->thread_count = 0;
+
+	pool->queue_head = NULL;
+	pool->queue_tail = NULL;
+	pool->pending_tasks = 0;
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->task_available, NULL);
+	pthread_cond_init(&pool->tasks_done, NULL);
+	pool->shutdown = false;
+
+	for (int i = 0; i < thread_count; i++) {
+		if (pthread_create(&pool->threads[i], NULL, &threadpool_worker, pool)
+				!= 0) {
+			throw_exception(ERRNO_EXCEPTION, -1,
+					"Unable to start thread #%d of the thread pool!", i);
+			break;
+		}
+		pool->thread_count++;
+	}
+
+	return pool;
+}
+
+void threadpool_submit(void (*task)(void*), void *arg, threadpool_t *pool) {
+	// Nothing could be started, so the caller's thread does the work instead
+	if (pool->thread_count == 0) {
+		(*task)(arg);
+		return;
+	}
+
+	threadpool_task_t *newTask = malloc(sizeof(threadpool_task_t));
+	newTask->task = task;
+	newTask->arg = arg;
+	newTask->next = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->queue_tail == NULL)
+		pool->queue_head = newTask;
+	else
+		pool->queue_tail->next = newTask;
+	pool->queue_tail = newTask;
+	pool->pending_tasks++;
+	pthread_cond_signal(&pool->task_available);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void threadpool_wait(threadpool_t *pool) {
+	pthread_mutex_lock(&pool->lock);
+	while (pool->pending_tasks > 0)
+		pthread_cond_wait(&pool->tasks_done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void threadpool_free(threadpool_t *pool) {
+	threadpool_wait(pool);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = true;
+	pthread_cond_broadcast(&pool->task_available);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 0; i < pool->thread_count; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->task_available);
+	pthread_cond_destroy(&pool->tasks_done);
+
+	free(pool->threads);
+	free(pool);
+}
+
+int threadpool_cpucount() {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int) count : 1;
+}
+
+static void* threadpool_worker(void *arg) {
+	threadpool_t *pool = arg;
+
+	pthread_mutex_lock(&pool->lock);
+	while (true) {
+		while (pool->queue_head == NULL && !pool->shutdown)
+			pthread_cond_wait(&pool->task_available, &pool->lock);
+		if (pool->queue_head == NULL)
+			break; // shutting down and nothing is left to do
+
+		threadpool_task_t *current = pool->queue_head;
+		pool->queue_head = current->next;
+		if (pool->queue_head == NULL)
+			pool->queue_tail = NULL;
+
+		// The task itself runs without holding the lock
+		pthread_mutex_unlock(&pool->lock);
+		(*current->task)(current->arg);
+		free(current);
+		pthread_mutex_lock(&pool->lock);
+
+		pool->pending_tasks--;
+		if (pool->pending_tasks == 0)
+			pthread_cond_broadcast(&pool->tasks_done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
@@ -37,40 +37,84 @@
 #include <stdarg.h>
 #include <ctype.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "../include/throwable.h"
 
 #define AVG_STRING_SIZE 2048
 
+static FILE *captureStream = NULL;
+static pthread_mutex_t captureLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Everything lives on the stack, so exceptions can be thrown from any number of interpreters
+ * running on different threads. The whole message is written with one call, so that lines
+ * from different threads don't get mixed together.
+ */
 void throw_exception(exception e, int lineNum, char *message, ...) {
-	// TODO: add a predefined message for errors like index out of bounds exception, etc.
+	// Read errno before anything else has the chance to change it
+	int errorNumber = errno;
+
+	char cMessage[AVG_STRING_SIZE];
+	int length;
+	if (lineNum == -1)
+		length = snprintf(cMessage, AVG_STRING_SIZE, "Internal Error [");
+	else if (lineNum == 0)
+		length = snprintf(cMessage, AVG_STRING_SIZE, "Error [");
+	else
+		length = snprintf(cMessage, AVG_STRING_SIZE, "Line #%d [", lineNum);
 
 	va_list args;
 	va_start(args, message);
-	char cMessage[AVG_STRING_SIZE];
-	if (lineNum == -1) {
-		strcpy(cMessage, "Internal Error [");
-		vsnprintf(cMessage, AVG_STRING_SIZE, message, args);
-		strcat(cMessage, "]");
-	} else {
-		snprintf(cMessage, AVG_STRING_SIZE, "Line #%d", lineNum);
-	}
+	length += vsnprintf(cMessage + length, AVG_STRING_SIZE - length, message,
+			args);
 	va_end(args);
+	if (length > AVG_STRING_SIZE - 1)
+		length = AVG_STRING_SIZE - 1;
 
-	// Goes through the different types of error and prints out the appropriate message
+	// Goes through the different types of error and finds the appropriate message
+	char *kind;
+	char reason[256]; // strerror() shares one buffer between all of the threads
 	switch (e) {
 	case ERRNO_EXCEPTION:
-		perror(cMessage);
+		if (strerror_r(errorNumber, reason, sizeof(reason)) != 0)
+			snprintf(reason, sizeof(reason), "Unknown error %d", errorNumber);
+		kind = reason;
 		break;
 	case NULL_POINTER_EXCEPTION:
-		fprintf(stderr, "%s: %s\n", cMessage, message);
+		kind = "NullPointerException";
 		break;
 	case INDEX_OUT_OF_BOUNDS_EXCEPTION:
-		fprintf(stderr, "%s: %s\n", cMessage, message);
+		kind = "IndexOutOfBoundsException";
+		break;
+	case SYNTAX_EXCEPTION:
+		kind = "SyntaxException";
+		break;
+	case STACK_OVERFLOW_EXCEPTION:
+		kind = "StackOverflowException";
 		break;
 	default:
+		kind = NULL;
 		break;
 	}
+
+	char line[AVG_STRING_SIZE + sizeof(reason) + 4];
+	if (kind != NULL)
+		snprintf(line, sizeof(line), "%s]: %s\n", cMessage, kind);
+	else
+		snprintf(line, sizeof(line), "%s]\n", cMessage);
+	fputs(line, stderr);
+
+	pthread_mutex_lock(&captureLock);
+	if (captureStream != NULL)
+		fputs(line, captureStream);
+	pthread_mutex_unlock(&captureLock);
+}
+
+void throw_capture(FILE *stream) {
+	pthread_mutex_lock(&captureLock);
+	captureStream = stream;
+	pthread_mutex_unlock(&captureLock);
 }
 
 #endif /* THROWABLE_C_ */
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * trace.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "../include/trace.h"
+
+static const char *trace_categories[] = { "phase", "io", "process", "call" };
+
+// Static Prototypes
+static void trace_copy(char *dest, const char *src, size_t size);
+static void trace_writestring(FILE *stream, const char *text);
+
+trace_t* trace_init(unsigned long capacity, long long callThreshold) {
+	trace_t *trace = malloc(sizeof(trace_t));
+	// Rounded up to a power of two, so the slot is a mask of the index
+	trace->capacity = 1;
+	while (trace->capacity < capacity)
+		trace->capacity *= 2;
+	trace->slots = calloc(trace->capacity, sizeof(trace_slot_t));
+	atomic_init(&trace->next, 0);
+	trace->call_threshold = callThreshold;
+	trace->origin = trace_now();
+	trace->thread = (int) syscall(SYS_gettid);
+	return trace;
+}
+
+long long trace_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+void trace_add(trace_category category, const char *name, const char *detail,
+		int lineNum, long long started, long long finished, trace_t *trace) {
+	unsigned long index = atomic_fetch_add_explicit(&trace->next, 1,
+			memory_order_relaxed);
+	trace_slot_t *slot = &trace->slots[index & (trace->capacity - 1)];
+
+	// A writer that is a whole lap behind can't be told apart from this one while it writes
+	atomic_store_explicit(&slot->sequence, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	trace_event_t *event = &slot->event;
+	event->category = category;
+	trace_copy(event->name, name, TRACE_NAME_SIZE);
+	trace_copy(event->detail, detail != NULL ? detail : "", TRACE_DETAIL_SIZE);
+	event->line_num = lineNum;
+	event->thread = (int) syscall(SYS_gettid);
+	event->started = started - trace->origin;
+	event->duration = finished - started;
+	atomic_store_explicit(&slot->sequence, index + 1, memory_order_release);
+}
+
+void trace_span(trace_category category, const char *name, const char *detail,
+		int lineNum, long long started, trace_t *trace) {
+	trace_add(category, name, detail, lineNum, started, trace_now(), trace);
+}
+
+void trace_write(FILE *stream, trace_t *trace) {
+	unsigned long next = atomic_load_explicit(&trace->next,
+			memory_order_acquire);
+	unsigned long first = next > trace->capacity ? next - trace->capacity : 0;
+	int pid = (int) getpid();
+
+	fprintf(stream, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(stream,
+			"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"interpreter\"}}",
+			pid, trace->thread);
+	for (unsigned long i = first; i < next; i++) {
+		trace_slot_t *slot = &trace->slots[i & (trace->capacity - 1)];
+		if (atomic_load_explicit(&slot->sequence, memory_order_acquire)
+				!= i + 1)
+			continue; // overwritten, or never finished
+		trace_event_t *event = &slot->event;
+		fprintf(stream, ",\n{\"name\":");
+		trace_writestring(stream, event->name);
+		fprintf(stream,
+				",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{",
+				trace_categories[event->category], event->started / 1000.0,
+				event->duration / 1000.0, pid, event->thread);
+		bool comma = false;
+		if (event->detail[0] != '\0') {
+			fprintf(stream, "\"detail\":");
+			trace_writestring(stream, event->detail);
+			comma = true;
+		}
+		if (event->line_num >= 0)
+			fprintf(stream, "%s\"line\":%d", comma ? "," : "", event->line_num);
+		fprintf(stream, "}}");
+	}
+	fprintf(stream, "\n]}\n");
+	if (first > 0)
+		fprintf(stderr, "The trace lost its first %lu events (it keeps %lu)\n",
+				first, trace->capacity);
+}
+
+void trace_free(trace_t *trace) {
+	free(trace->slots);
+	free(trace);
+}
+
+static void trace_copy(char *dest, const char *src, size_t size) {
+	size_t length = strnlen(src, size - 1);
+	memcpy(dest, src, length);
+	dest[length] = '\0';
+}
+
+// As a JSON string, with quotes
+static void trace_writestring(FILE *stream, const char *text) {
+	fputc('"', stream);
+	for (const unsigned char *letter = (const unsigned char*) text; *letter;
+			letter++) {
+		if (*letter == '"' || *letter == '\\')
+			fprintf(stream, "\\%c", *letter);
+		else if (*letter < 0x20)
+			fprintf(stream, "\\u%04x", *letter);
+		else
+			fputc(*letter, stream);
+	}
+	fputc('"', stream);
+}
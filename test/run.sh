@@ -0,0 +1,133 @@
+#!/bin/sh
+#
+# Regression tests (make test). Usage: test/run.sh path/to/freeze
+#
+# test/NAME.fz runs with and without --no-jit, and test/stream/NAME.fz is piped into
+# freeze --stream -. Either has to print NAME.out next to it, followed by its exit status
+# ("status 0"). If there is a NAME.err, the first line of the exceptions has to contain it.
+#
+# test/reload/NAME.fz is served with --serve, and every request of NAME.calls is sent to it.
+# Then NAME.fz is replaced by NAME.edited.fz (if there is one) and the requests are sent again
+# (or the ones of NAME.edited.calls, if there is one). The responses of both rounds (one per
+# line, with the exceptions the client got) have to be NAME.out.
+#
+# test/NAME.fz is also translated with --emit-c, and the program built from it has to print
+# NAME.out too. test/emitc/NAME.fz has to be refused by --emit-c, with the exception of
+# NAME.err.
+
+freeze=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+tests=$(cd "$(dirname "$0")" && pwd)
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch"' EXIT
+failed=0
+
+# check name expected actual
+check() {
+	if cmp -s "$2" "$3"; then
+		echo "ok      $1"
+	else
+		echo "FAILED  $1"
+		diff "$2" "$3" | sed 's/^/        /'
+		failed=$((failed + 1))
+	fi
+}
+
+# checkerror name script
+checkerror() {
+	err="${2%.fz}.err"
+	if [ -f "$err" ] && ! head -n 1 "$scratch/stderr" | grep -qF "$(cat "$err")"; then
+		echo "FAILED  $1 (expected the exception \"$(cat "$err")\")"
+		sed 's/^/        /' "$scratch/stderr"
+		failed=$((failed + 1))
+	fi
+}
+
+for script in "$tests"/*.fz; do
+	[ -f "${script%.fz}.out" ] || continue
+	name=$(basename "$script")
+	for flags in "" "--no-jit"; do
+		# Scripts run in the scratch directory, for the files they write
+		(cd "$scratch" && "$freeze" $flags "$script" > stdout 2> stderr
+			echo "status $?" >> stdout)
+		check "$name${flags:+ $flags}" "${script%.fz}.out" "$scratch/stdout"
+		checkerror "$name${flags:+ $flags}" "$script"
+	done
+done
+
+for script in "$tests"/*.fz; do
+	[ -f "${script%.fz}.out" ] || continue
+	name="$(basename "$script") --emit-c"
+	if ! "$freeze" --emit-c "$scratch/program.c" "$script" 2> "$scratch/stderr" \
+			|| ! ${CC:-cc} -O2 -Wall -Werror -o "$scratch/program" "$scratch/program.c" \
+					-lm -lpthread 2>> "$scratch/stderr"; then
+		echo "FAILED  $name"
+		sed 's/^/        /' "$scratch/stderr"
+		failed=$((failed + 1))
+		continue
+	fi
+	(cd "$scratch" && ./program > stdout 2> stderr
+		echo "status $?" >> stdout)
+	check "$name" "${script%.fz}.out" "$scratch/stdout"
+	checkerror "$name" "$script"
+done
+
+for script in "$tests"/emitc/*.fz; do
+	[ -f "${script%.fz}.err" ] || continue
+	name=emitc/$(basename "$script")
+	if "$freeze" --emit-c "$scratch/program.c" "$script" 2> "$scratch/stderr"; then
+		echo "FAILED  $name (expected --emit-c to refuse it)"
+		failed=$((failed + 1))
+	else
+		before=$failed
+		checkerror "$name" "$script"
+		[ $failed -gt $before ] || echo "ok      $name"
+	fi
+done
+
+for script in "$tests"/stream/*.fz; do
+	[ -f "${script%.fz}.out" ] || continue
+	name=stream/$(basename "$script")
+	(cd "$scratch" && "$freeze" --stream - < "$script" > stdout 2> stderr
+		echo "status $?" >> stdout)
+	check "$name" "${script%.fz}.out" "$scratch/stdout"
+	checkerror "$name" "$script"
+done
+
+for script in "$tests"/reload/*.fz; do
+	case "$script" in *.edited.fz) continue ;; esac
+	[ -f "${script%.fz}.out" ] || continue
+	name=reload/$(basename "$script")
+	served="$scratch/$(basename "$script")"
+	socket="$scratch/socket"
+	cp "$script" "$served"
+	"$freeze" --serve "$socket" "$served" 2> "$scratch/stderr" &
+	server=$!
+	tries=0
+	while [ ! -S "$socket" ] && [ $tries -lt 50 ]; do
+		sleep 0.1
+		tries=$((tries + 1))
+	done
+
+	: > "$scratch/stdout"
+	for version in "$script" "${script%.fz}.edited.fz"; do
+		[ -f "$version" ] || continue
+		# The copy keeps the size and time of the file from matching what was loaded
+		cp "$version" "$served.new" && mv "$served.new" "$served"
+		calls="${version%.fz}.calls"
+		[ -f "$calls" ] || calls="${script%.fz}.calls"
+		while IFS= read -r request; do
+			"$freeze" --call "$socket" "$(basename "$script") $request" \
+				>> "$scratch/stdout" 2>&1
+			echo >> "$scratch/stdout"
+		done < "$calls"
+	done
+	kill $server 2> /dev/null
+	wait $server 2> /dev/null
+	rm -f "$socket"
+	check "$name" "${script%.fz}.out" "$scratch/stdout"
+done
+
+if [ $failed -gt 0 ]; then
+	echo "$failed tests failed"
+	exit 1
+fi
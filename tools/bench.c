@@ -0,0 +1,496 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+/*
+ * Benchmarks of the building blocks of the interpreter and of whole scripts (make bench).
+ *
+ * Usage: bench --freeze path/to/freeze --workloads dir [--output results.json]
+ *              [--baseline baseline.json] [--tolerance percent]
+ *
+ * Every micro benchmark runs until it has taken BENCH_MIN_NANOSECONDS, BENCH_REPEATS times,
+ * and the fastest run counts (the others were slowed down by something else). Every .fz script
+ * in the workload directory is run by freeze the same way, inside of a temporary directory for
+ * the files it writes. The results are in nanoseconds per operation (or per run of a script):
+ *
+ * { "unit": "nanoseconds", "results": { "string_append": 4.2, "loop.fz": 41000000 } }
+ *
+ * With a baseline (the results of an earlier run), every result that is slower than the
+ * baseline by more than the tolerance is a regression, and the exit status is 1.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../include/stringobj.h"
+#include "../include/listobj.h"
+#include "../include/interpreter.h"
+#include "../deps/tinyexpr/tinyexpr.h"
+
+#define BENCH_REPEATS 5
+#define BENCH_WORKLOAD_REPEATS 3
+#define BENCH_MIN_NANOSECONDS 50000000LL
+#define BENCH_DEFAULT_TOLERANCE 20.0 // percent
+#define BENCH_LIST_SIZE 1000
+#define BENCH_SCRIPT_LINES 10000
+
+typedef struct {
+	char *name;
+	double nanoseconds; // per operation
+} bench_result_t;
+
+typedef struct {
+	char *name;
+	long (*run)(void); // does some operations and returns how many
+} bench_micro_t;
+
+extern char **environ;
+
+// Keeps the compiler from optimizing the benchmarks away
+static volatile long bench_sink;
+
+// Static Prototypes
+static long long bench_now(void);
+static long bench_stringappend(void);
+static long bench_stringsplit(void);
+static long bench_stringequals(void);
+static long bench_listadd(void);
+static long bench_listremove(void);
+static long bench_listcontains(void);
+static long bench_tecompile(void);
+static long bench_teeval(void);
+static long bench_parse(void);
+static long bench_preprocess(void);
+static bool bench_equals(void *a, void *b);
+static void bench_runmicro(bench_micro_t *micro, list_t *results);
+static bool bench_runworkloads(char *freeze, char *directory, list_t *results);
+static long long bench_runscript(char *freeze, char *script);
+static void bench_add(char *name, double nanoseconds, list_t *results);
+static bool bench_write(char *path, list_t *results);
+static list_t* bench_read(char *path);
+static int bench_compare(list_t *results, list_t *baseline, double tolerance);
+
+static bench_micro_t bench_micros[] = {
+		{ "string_append", &bench_stringappend },
+		{ "string_split", &bench_stringsplit },
+		{ "string_equals", &bench_stringequals },
+		{ "list_add", &bench_listadd },
+		{ "list_remove", &bench_listremove },
+		{ "list_contains", &bench_listcontains },
+		{ "te_compile", &bench_tecompile },
+		{ "te_eval", &bench_teeval },
+		{ "parse", &bench_parse },
+		{ "preprocess", &bench_preprocess } };
+
+int main(int argc, char **argv) {
+	char *freeze = NULL, *workloads = NULL, *output = NULL, *baselinePath =
+	NULL;
+	double tolerance = BENCH_DEFAULT_TOLERANCE;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--freeze") == 0 && i + 1 < argc)
+			freeze = argv[++i];
+		else if (strcmp(argv[i], "--workloads") == 0 && i + 1 < argc)
+			workloads = argv[++i];
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+			baselinePath = argv[++i];
+		else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+			tolerance = atof(argv[++i]);
+		else {
+			fprintf(stderr,
+					"Usage: %s --freeze path --workloads dir [--output results.json]"
+							" [--baseline baseline.json] [--tolerance percent]\n",
+					argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (freeze == NULL || workloads == NULL) {
+		fprintf(stderr, "%s: --freeze and --workloads are needed\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	list_t *results = list_init();
+	for (size_t i = 0; i < sizeof(bench_micros) / sizeof(bench_micro_t); i++)
+		bench_runmicro(&bench_micros[i], results);
+	int status = EXIT_SUCCESS;
+	if (!bench_runworkloads(freeze, workloads, results))
+		status = EXIT_FAILURE;
+	if (output != NULL && !bench_write(output, results))
+		status = EXIT_FAILURE;
+
+	// Without a baseline (like on the first run), there is nothing to compare the results to
+	list_t *baseline = NULL;
+	if (baselinePath != NULL && (baseline = bench_read(baselinePath)) == NULL)
+		fprintf(stderr, "No baseline in %s (make bench-baseline stores one)\n",
+				baselinePath);
+	if (baseline != NULL) {
+		if (bench_compare(results, baseline, tolerance) > 0)
+			status = EXIT_FAILURE;
+		for (int i = 0; i < baseline->data_length; i++)
+			free(((bench_result_t*) baseline->data[i])->name);
+		list_complete_free(&free, baseline);
+	} else {
+		for (int i = 0; i < results->data_length; i++) {
+			bench_result_t *result = results->data[i];
+			printf("%-20s %16.1f ns\n", result->name, result->nanoseconds);
+		}
+	}
+
+	for (int i = 0; i < results->data_length; i++)
+		free(((bench_result_t*) results->data[i])->name);
+	list_complete_free(&free, results);
+	return status;
+}
+
+static long long bench_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static long bench_stringappend(void) {
+	string_t *str = string_init();
+	for (int i = 0; i < BENCH_LIST_SIZE; i++)
+		string_append(str, "abc");
+	bench_sink += str->text_length;
+	string_free(str);
+	return BENCH_LIST_SIZE;
+}
+
+static long bench_stringsplit(void) {
+	string_t *line = string_copyvalueof("set total, total + i * 2");
+	for (int i = 0; i < BENCH_LIST_SIZE; i++) {
+		string_t **pair = string_split(' ', line);
+		bench_sink += pair[1]->text_length;
+		string_free(pair[0]);
+		string_free(pair[1]);
+		free(pair);
+	}
+	string_free(line);
+	return BENCH_LIST_SIZE;
+}
+
+static long bench_stringequals(void) {
+	string_t *str = string_copyvalueof("functionend");
+	for (int i = 0; i < BENCH_LIST_SIZE; i++)
+		bench_sink += string_equals(str, "functionend")
+				+ string_equals(str, "function");
+	string_free(str);
+	return 2 * BENCH_LIST_SIZE;
+}
+
+static long bench_listadd(void) {
+	list_t *list = list_init();
+	for (long i = 0; i < BENCH_LIST_SIZE; i++)
+		list_add((void*) i, list);
+	bench_sink += list->data_length;
+	list_free(list);
+	return BENCH_LIST_SIZE;
+}
+
+// Removes from the front (the worst case) of a list with BENCH_LIST_SIZE items
+static long bench_listremove(void) {
+	list_t *list = list_init();
+	for (long i = 0; i < BENCH_LIST_SIZE; i++)
+		list_add((void*) i, list);
+	for (int i = 0; i < BENCH_LIST_SIZE / 10; i++)
+		list_remove(0, list);
+	bench_sink += list->data_length;
+	list_free(list);
+	return BENCH_LIST_SIZE / 10;
+}
+
+// Looks for the last of 100 strings
+static long bench_listcontains(void) {
+	list_t *list = list_init();
+	char name[16];
+	for (int i = 0; i < 100; i++) {
+		snprintf(name, sizeof(name), "var%d", i);
+		list_add(string_copyvalueof(name), list);
+	}
+	for (int i = 0; i < 100; i++)
+		bench_sink += list_contains("var99", &bench_equals, list);
+	list_complete_free(&string_free, list);
+	return 100;
+}
+
+static long bench_tecompile(void) {
+	double x = 1, y = 2;
+	te_variable variables[] = { { "x", &x, TE_VARIABLE, NULL }, { "y", &y,
+			TE_VARIABLE, NULL } };
+	for (int i = 0; i < 100; i++) {
+		te_expr *expr = te_compile("x * 2 + sqrt(y) / 3 - (x ^ 2)", variables,
+				2, NULL);
+		bench_sink += expr != NULL;
+		te_free(expr);
+	}
+	return 100;
+}
+
+static long bench_teeval(void) {
+	double x = 1, y = 2;
+	te_variable variables[] = { { "x", &x, TE_VARIABLE, NULL }, { "y", &y,
+			TE_VARIABLE, NULL } };
+	te_expr *expr = te_compile("x * 2 + sqrt(y) / 3 - (x ^ 2)", variables, 2,
+	NULL);
+	double sum = 0;
+	for (int i = 0; i < BENCH_LIST_SIZE; i++) {
+		x = i;
+		sum += te_eval(expr);
+	}
+	bench_sink += (long) sum;
+	te_free(expr);
+	return BENCH_LIST_SIZE;
+}
+
+static long bench_parse(void) {
+	string_t *line = string_init();
+	for (int i = 0; i < 100; i++) {
+		string_reset(line);
+		string_append(line, "print \"x is \", x * 2 + 1, \"\\n\"");
+		parsed_instruction_t *instr = parse(' ', ',', line);
+		bench_sink += instr->args->data_length;
+		parsed_instruction_free(instr);
+	}
+	string_free(line);
+	return 100;
+}
+
+// A whole script of BENCH_SCRIPT_LINES lines, per line
+static long bench_preprocess(void) {
+	static char *script = NULL;
+	static size_t length = 0;
+	if (script == NULL) {
+		string_t *text = string_init();
+		char line[128];
+		for (int i = 0; i < BENCH_SCRIPT_LINES / 4; i++) {
+			snprintf(line, sizeof(line),
+					"set x%d, %d\nadd x%d, x%d * 2\nprint \"x\", x%d\ngotoline 1, x%d < 0\n",
+					i, i, i, i, i, i);
+			string_append(text, line);
+		}
+		length = text->text_length;
+		script = strdup(text->text);
+		string_free(text);
+	}
+	FILE *stream = fmemopen(script, length, "r");
+	vm_t *vm = vm_init();
+	interpreter_preprocessfile(stream, vm);
+	bench_sink += vm->error_count;
+	vm_free(vm);
+	fclose(stream);
+	return BENCH_SCRIPT_LINES;
+}
+
+static bool bench_equals(void *a, void *b) {
+	return string_equals(b, a);
+}
+
+static void bench_runmicro(bench_micro_t *micro, list_t *results) {
+	double fastest = -1;
+	for (int repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+		long operations = 0;
+		long long started = bench_now(), elapsed;
+		do {
+			operations += micro->run();
+			elapsed = bench_now() - started;
+		} while (elapsed < BENCH_MIN_NANOSECONDS);
+		double nanoseconds = (double) elapsed / operations;
+		if (fastest < 0 || nanoseconds < fastest)
+			fastest = nanoseconds;
+	}
+	bench_add(micro->name, fastest, results);
+}
+
+// Runs every .fz script of the directory (in order by name)
+static bool bench_runworkloads(char *freeze, char *directory, list_t *results) {
+	char freezePath[PATH_MAX], directoryPath[PATH_MAX];
+	if (realpath(freeze, freezePath) == NULL) {
+		perror(freeze);
+		return false;
+	}
+	if (realpath(directory, directoryPath) == NULL) {
+		perror(directory);
+		return false;
+	}
+	struct dirent **entries;
+	int count = scandir(directoryPath, &entries, NULL, &alphasort);
+	if (count < 0) {
+		perror(directoryPath);
+		return false;
+	}
+
+	// The scripts write their files in here
+	char scratch[] = "/tmp/freeze-bench-XXXXXX", previous[PATH_MAX];
+	bool succeeded = mkdtemp(scratch) != NULL
+			&& getcwd(previous, sizeof(previous)) != NULL && chdir(scratch) == 0;
+	for (int i = 0; i < count; i++) {
+		char *name = entries[i]->d_name;
+		size_t length = strlen(name);
+		if (succeeded && length > 3 && strcmp(name + length - 3, ".fz") == 0) {
+			char script[2 * PATH_MAX];
+			snprintf(script, sizeof(script), "%s/%s", directoryPath, name);
+			long long fastest = -1;
+			for (int repeat = 0; repeat < BENCH_WORKLOAD_REPEATS && succeeded;
+					repeat++) {
+				long long elapsed = bench_runscript(freezePath, script);
+				if (elapsed < 0) {
+					fprintf(stderr, "%s failed\n", name);
+					succeeded = false;
+				} else if (fastest < 0 || elapsed < fastest) {
+					fastest = elapsed;
+				}
+			}
+			if (succeeded)
+				bench_add(name, fastest, results);
+		}
+		free(entries[i]);
+	}
+	free(entries);
+
+	if (chdir(previous) != 0)
+		succeeded = false;
+	char command[PATH_MAX + 16];
+	snprintf(command, sizeof(command), "rm -rf '%s'", scratch);
+	if (system(command) != 0)
+		succeeded = false;
+	return succeeded;
+}
+
+// Returns how long the script took, or -1 if it couldn't run or failed
+static long long bench_runscript(char *freeze, char *script) {
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null",
+	O_WRONLY, 0);
+	char *args[] = { freeze, script, NULL };
+	long long started = bench_now();
+	pid_t pid;
+	int spawned = posix_spawn(&pid, freeze, &actions, NULL, args, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	int status;
+	if (spawned != 0 || waitpid(pid, &status, 0) != pid)
+		return -1;
+	long long elapsed = bench_now() - started;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? elapsed : -1;
+}
+
+static void bench_add(char *name, double nanoseconds, list_t *results) {
+	bench_result_t *result = malloc(sizeof(bench_result_t));
+	result->name = strdup(name);
+	result->nanoseconds = nanoseconds;
+	list_add(result, results);
+}
+
+static bool bench_write(char *path, list_t *results) {
+	FILE *stream = fopen(path, "w");
+	if (stream == NULL) {
+		perror(path);
+		return false;
+	}
+	fprintf(stream, "{\n  \"unit\": \"nanoseconds\",\n  \"results\": {\n");
+	for (int i = 0; i < results->data_length; i++) {
+		bench_result_t *result = results->data[i];
+		fprintf(stream, "    \"%s\": %.1f%s\n", result->name,
+				result->nanoseconds, i + 1 < results->data_length ? "," : "");
+	}
+	fprintf(stream, "  }\n}\n");
+	return fclose(stream) == 0;
+}
+
+// Reads the results back from what bench_write() wrote, or returns NULL
+static list_t* bench_read(char *path) {
+	FILE *stream = fopen(path, "r");
+	if (stream == NULL)
+		return NULL;
+	string_t *text = string_init();
+	char buffer[4096];
+	size_t length;
+	while ((length = fread(buffer, 1, sizeof(buffer) - 1, stream)) > 0) {
+		buffer[length] = '\0';
+		string_append(text, buffer);
+	}
+	fclose(stream);
+
+	list_t *results = NULL;
+	char *next = strstr(text->text, "\"results\"");
+	if (next != NULL && (next = strchr(next, '{')) != NULL) {
+		results = list_init();
+		// Every "name": number pair until the end of the object
+		while ((next = strpbrk(next + 1, "\"}")) != NULL && *next == '"') {
+			char *end = strchr(next + 1, '"');
+			char *colon = end != NULL ? strchr(end, ':') : NULL;
+			if (colon == NULL)
+				break;
+			*end = '\0';
+			char *name = next + 1;
+			bench_add(name, strtod(colon + 1, &next), results);
+		}
+	}
+	string_free(text);
+	return results;
+}
+
+// Prints every result next to its baseline, and returns the number of regressions
+static int bench_compare(list_t *results, list_t *baseline, double tolerance) {
+	int regressions = 0;
+	printf("%-20s %16s %16s %9s\n", "benchmark", "baseline ns", "ns", "change");
+	for (int i = 0; i < results->data_length; i++) {
+		bench_result_t *result = results->data[i], *before = NULL;
+		for (int j = 0; j < baseline->data_length && before == NULL; j++)
+			if (strcmp(((bench_result_t*) baseline->data[j])->name,
+					result->name) == 0)
+				before = baseline->data[j];
+		if (before == NULL || before->nanoseconds <= 0) {
+			printf("%-20s %16s %16.1f %9s\n", result->name, "-",
+					result->nanoseconds, "new");
+			continue;
+		}
+		double change = 100.0 * (result->nanoseconds - before->nanoseconds)
+				/ before->nanoseconds;
+		bool regressed = change > tolerance;
+		regressions += regressed;
+		printf("%-20s %16.1f %16.1f %+8.1f%%%s\n", result->name,
+				before->nanoseconds, result->nanoseconds, change,
+				regressed ? "  REGRESSION" : "");
+	}
+	if (regressions > 0)
+		printf("%d benchmarks are slower than the baseline by more than %g%%\n",
+				regressions, tolerance);
+	return regressions;
+}
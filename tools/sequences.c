@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2021, suncloudsmoon and the Bootstrapped Freeze Interpreter contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * sequences.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: suncloudsmoon
+ */
+
+/*
+ * Finds superinstruction candidates in instruction counts (written by freeze --counts).
+ *
+ * Usage: sequences counts.txt [top]
+ *
+ * Every run of 2 to SEQUENCE_MAX_LENGTH instructions that follow each other inside of a
+ * function is a candidate. A sequence can run at most as often as its least run instruction,
+ * so that count is its weight. The weights of equal sequences (by instruction names) are added
+ * up over the whole program, and the heaviest ones are printed first.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/stringobj.h"
+#include "../include/listobj.h"
+#include "../include/mapobj.h"
+
+#define SEQUENCE_MAX_LENGTH 4
+#define SEQUENCE_DEFAULT_TOP 20
+
+typedef struct {
+	string_t *function, *name;
+	long count;
+} counted_instruction_t;
+
+typedef struct {
+	string_t *names; // separated by spaces
+	long weight;
+	int length;
+} sequence_t;
+
+// Static Prototypes
+static list_t* sequences_read(FILE *stream);
+static void sequences_mine(list_t *instructions, list_t *sequences,
+		map_t *index);
+static int sequences_compare(const void *first, const void *second);
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s counts.txt [top]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	FILE *stream = fopen(argv[1], "r");
+	if (stream == NULL) {
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+	int top = argc > 2 ? atoi(argv[2]) : SEQUENCE_DEFAULT_TOP;
+
+	list_t *instructions = sequences_read(stream);
+	fclose(stream);
+
+	list_t *sequences = list_init();
+	map_t *index = map_init();
+	sequences_mine(instructions, sequences, index);
+	qsort(sequences->data, sequences->data_length, sizeof(void*),
+			&sequences_compare);
+
+	printf("weight\tlength\tsequence\n");
+	for (int i = 0; i < sequences->data_length && i < top; i++) {
+		sequence_t *sequence = sequences->data[i];
+		if (sequence->weight == 0)
+			break;
+		printf("%ld\t%d\t%s\n", sequence->weight, sequence->length,
+				sequence->names->text);
+	}
+
+	map_free(index);
+	for (int i = 0; i < sequences->data_length; i++) {
+		sequence_t *sequence = sequences->data[i];
+		string_free(sequence->names);
+		free(sequence);
+	}
+	list_free(sequences);
+	for (int i = 0; i < instructions->data_length; i++) {
+		counted_instruction_t *instr = instructions->data[i];
+		string_free(instr->function);
+		string_free(instr->name);
+		free(instr);
+	}
+	list_free(instructions);
+
+	return EXIT_SUCCESS;
+}
+
+// Lines look like "function<TAB>line<TAB>count<TAB>name"
+static list_t* sequences_read(FILE *stream) {
+	list_t *instructions = list_init();
+	char *line = NULL;
+	size_t capacity = 0;
+	ssize_t length;
+	while ((length = getline(&line, &capacity, stream)) != -1) {
+		if (length > 0 && line[length - 1] == '\n')
+			line[--length] = '\0';
+
+		char *function = strtok(line, "\t");
+		char *lineNum = strtok(NULL, "\t");
+		char *count = strtok(NULL, "\t");
+		char *name = strtok(NULL, "\t");
+		if (function == NULL || lineNum == NULL || count == NULL
+				|| name == NULL)
+			continue;
+
+		counted_instruction_t *instr = malloc(sizeof(counted_instruction_t));
+		instr->function = string_copyvalueof(function);
+		instr->name = string_copyvalueof(name);
+		instr->count = atol(count);
+		list_add(instr, instructions);
+	}
+	free(line);
+	return instructions;
+}
+
+static void sequences_mine(list_t *instructions, list_t *sequences,
+		map_t *index) {
+	for (int start = 0; start < instructions->data_length; start++) {
+		counted_instruction_t *first = instructions->data[start];
+		string_t *names = string_copyvalueof_s(first->name);
+		long weight = first->count;
+
+		for (int length = 2;
+				length <= SEQUENCE_MAX_LENGTH
+						&& start + length <= instructions->data_length;
+				length++) {
+			counted_instruction_t *instr = instructions->data[start + length
+					- 1];
+			// Sequences don't go from one function into the next
+			if (!string_equals_s(instr->function, first->function))
+				break;
+			string_appendchar(names, ' ');
+			string_append_s(names, instr->name);
+			if (instr->count < weight)
+				weight = instr->count;
+
+			sequence_t *sequence = map_get(names, index);
+			if (sequence == NULL) {
+				sequence = malloc(sizeof(sequence_t));
+				sequence->names = string_copyvalueof_s(names);
+				sequence->weight = 0;
+				sequence->length = length;
+				list_add(sequence, sequences);
+				map_put(sequence->names, sequence, index);
+			}
+			sequence->weight += weight;
+		}
+		string_free(names);
+	}
+}
+
+// Heaviest first, and shorter sequences first when the weights are the same
+static int sequences_compare(const void *first, const void *second) {
+	sequence_t *a = *(sequence_t**) first, *b = *(sequence_t**) second;
+	if (a->weight != b->weight)
+		return a->weight < b->weight ? 1 : -1;
+	return a->length - b->length;
+}